@@ -0,0 +1,268 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <utility>
+#include <vector>
+#include "stats.hpp"
+#include "symmetry.hpp"
+#include "util.hpp"
+
+namespace player {
+
+// A negamax alpha-beta search with iterative deepening, a transposition
+// table, killer and history move ordering, and aspiration windows.
+// Positions are scored by an evaluator for the player to move, by default
+// GameTraits::Evaluate. The player to move may stay the same after a move,
+// as after a pass in othello.
+template<class GameTraits>
+class AlphaBeta {
+ public:
+  using Board = typename GameTraits::Board;
+  using Move = typename GameTraits::Move;
+  using Player = typename GameTraits::Player;
+  using History = typename GameTraits::History;
+  // Estimates the final score of a position for the player to move, on the
+  // scale of GameTraits::GetScore.
+  using Evaluator = std::function<double(const Board&)>;
+
+  explicit AlphaBeta(std::chrono::milliseconds thinking_time)
+      : thinking_time_(thinking_time),
+        max_depth_(0),
+        aspiration_window_(50),
+        evaluator_(GameTraits::Evaluate),
+        table_(size_t{1} << 20),
+        history_(),
+        aborted_(false),
+        stats_sink_(nullptr) {
+  }
+
+  void SetThinkingTime(const std::chrono::milliseconds t) { thinking_time_ = t; }
+
+  // Searches exactly to the given depth instead of deepening until the
+  // thinking time is over, so that the same position always produces the
+  // same move. 0 restores the time-bound search.
+  void SetMaxDepth(const size_t depth) { max_depth_ = depth; }
+
+  // Half-width of the window around the previous iteration's score, in
+  // thousandths of the score scale; 0 always searches with a full window.
+  void SetAspirationWindow(const int width) { aspiration_window_ = width; }
+
+  void SetEvaluator(Evaluator evaluator) { evaluator_ = std::move(evaluator); }
+
+  // Resizes the transposition table to 2^bits entries and clears it.
+  void SetTableBits(const int bits) { table_.assign(size_t{1} << bits, Entry()); }
+
+  // Writes the stats of every move as a line of JSON to os; nullptr disables.
+  void SetStatsSink(std::ostream* os) { stats_sink_ = os; }
+
+  const SearchStats& last_stats() const { return last_stats_; }
+  const SearchStats& total_stats() const { return total_stats_; }
+
+  const char* GetName() const { return "AlphaBeta"; }
+
+  Move GetNextMove(const Board& board, const History& history) {
+    start_time_ = std::chrono::steady_clock::now();
+    SearchStats& stats = last_stats_;
+    stats.Clear();
+    aborted_ = false;
+    for (auto& k : killers_) k.fill(GameTraits::GetIllegalMove());
+    for (auto& h : history_) h /= 8;  // keep a little of what earlier moves taught
+
+    Move best = GameTraits::GetIllegalMove();
+    int score = 0;
+    const size_t max_depth = max_depth_ ? max_depth_ : MaxPly - 1;
+    for (size_t depth = 1; depth <= max_depth; ++depth) {
+      int alpha = -Infinity;
+      int beta = Infinity;
+      if (depth > 1 && aspiration_window_) {
+        alpha = score - aspiration_window_;
+        beta = score + aspiration_window_;
+      }
+      Move m = GameTraits::GetIllegalMove();
+      int s = SearchRoot(board, depth, alpha, beta, m);
+      if (!aborted_ && (s <= alpha || s >= beta)) {
+        s = SearchRoot(board, depth, -Infinity, Infinity, m);  // outside the window
+      }
+      if (aborted_) break;
+      best = m;
+      score = s;
+      stats.iterations = depth;
+      stats.max_depth = depth;
+      if (std::abs(score) >= WinScore - static_cast<int>(MaxPly)) break;  // the outcome is known
+    }
+    if (best == GameTraits::GetIllegalMove()) best = board.GetLegalMoves().front();
+
+    stats.moves = 1;
+    stats.value = static_cast<double>(score) / ScoreScale;
+    stats.memory_bytes = table_.size() * sizeof(Entry);
+    stats.time = std::chrono::steady_clock::now() - start_time_;
+    total_stats_.Merge(stats);
+    if (stats_sink_) {
+      stats.WriteJson(*stats_sink_);
+      *stats_sink_ << '\n';
+    }
+    return best;
+  }
+
+ private:
+  static constexpr size_t MaxPly = 64;
+  static constexpr int ScoreScale = 1000;     // of the evaluator's [-1, 1]
+  static constexpr int WinScore = 100000;     // less the plies to the end
+  static constexpr int Infinity = 1000000;
+  static constexpr size_t MaxMoves = GameTraits::MaxPos * GameTraits::MaxPos;
+  enum Bound : uint8_t { EXACT, LOWER, UPPER };
+
+  struct Entry {
+    uint64_t key;
+    int32_t score;
+    Move move;
+    uint8_t depth;
+    Bound bound;
+
+    Entry() : key(0), score(0), move(GameTraits::GetIllegalMove()), depth(0), bound(EXACT) {}
+  };
+
+  // The score of a finished game for p, with wins preferred the sooner they
+  // come and by the widest margin.
+  static int GetTerminalScore(const Board& board, const Player p, const size_t ply) {
+    const int margin = std::lround(ScoreScale * GameTraits::GetScore(board, p));
+    if (board.IsDraw()) return margin;
+    return (board.winner() == p ? WinScore - static_cast<int>(ply) : -WinScore + static_cast<int>(ply)) + margin;
+  }
+
+  // Win and loss scores count the plies from the root of the search. The
+  // table keeps them counted from the entry's own position instead, so that
+  // a hit at another ply, or in a later search, gives the right distance.
+  static bool IsWinOrLoss(const int score) {
+    return std::abs(score) >= WinScore - static_cast<int>(MaxPly) - ScoreScale;
+  }
+
+  static int ToTableScore(const int score, const size_t ply) {
+    if (!IsWinOrLoss(score)) return score;
+    return score > 0 ? score + static_cast<int>(ply) : score - static_cast<int>(ply);
+  }
+
+  static int FromTableScore(const int score, const size_t ply) {
+    if (!IsWinOrLoss(score)) return score;
+    return score > 0 ? score - static_cast<int>(ply) : score + static_cast<int>(ply);
+  }
+
+  bool IsOutOfTime() {
+    if (max_depth_ || aborted_) return aborted_;
+    if ((last_stats_.nodes & 1023) == 0) {
+      aborted_ = std::chrono::steady_clock::now() - start_time_ >= thinking_time_;
+    }
+    return aborted_;
+  }
+
+  int SearchRoot(const Board& board, const size_t depth, int alpha, int beta, Move& best) {
+    Board b = board;
+    return Search(b, depth, 0, alpha, beta, &best);
+  }
+
+  // Returns the score of board for the player to move, searched depth plies
+  // deep, and the best move in *best if it is given. Moves are made and
+  // taken back on board itself, which is unchanged on return.
+  int Search(Board& board, const size_t depth, const size_t ply, int alpha, int beta,
+             Move* best = nullptr) {
+    ++last_stats_.nodes;
+    if (depth == 0) return std::lround(ScoreScale * evaluator_(board));
+    if (IsOutOfTime()) return 0;
+
+    const uint64_t key = symmetry::GetKey<GameTraits>(board);
+    Entry& entry = table_[key & (table_.size() - 1)];
+    Move tt_move = GameTraits::GetIllegalMove();
+    if (entry.key == key) {
+      tt_move = entry.move;
+      const int score = FromTableScore(entry.score, ply);
+      if (!best && entry.depth >= depth) {
+        if (entry.bound == EXACT) return score;
+        if (entry.bound == LOWER && score >= beta) return score;
+        if (entry.bound == UPPER && score <= alpha) return score;
+      }
+    }
+
+    auto moves = board.GetLegalMoves();
+    OrderMoves(moves, tt_move, ply);
+    const int alpha0 = alpha;
+    const Player p = board.current_player();
+    int best_score = -Infinity;
+    Move best_move = moves.front();
+    typename Board::UndoInfo undo;
+    for (const auto m : moves) {
+      board.Next(m, undo);
+      int s;
+      if (board.IsFinished()) {
+        ++last_stats_.nodes;
+        s = GetTerminalScore(board, p, ply + 1);
+      } else if (board.current_player() == p) {  // the opponent passed
+        s = Search(board, depth - 1, ply + 1, alpha, beta);
+      } else {
+        s = -Search(board, depth - 1, ply + 1, -beta, -alpha);
+      }
+      board.Undo(undo);
+      if (aborted_) return 0;
+      if (s > best_score) {
+        best_score = s;
+        best_move = m;
+      }
+      if (s > alpha) alpha = s;
+      if (alpha >= beta) {
+        RememberCutoff(m, depth, ply);
+        break;
+      }
+    }
+
+    entry.key = key;
+    entry.score = ToTableScore(best_score, ply);
+    entry.move = best_move;
+    entry.depth = depth;
+    entry.bound = best_score <= alpha0 ? UPPER : best_score >= beta ? LOWER : EXACT;
+    if (best) *best = best_move;
+    return best_score;
+  }
+
+  // the move from the table first, then the killers, then by history
+  void OrderMoves(std::vector<Move>& moves, const Move tt_move, const size_t ply) const {
+    const auto& killers = killers_[ply];
+    auto rank = [this, tt_move, &killers] (const Move m) {
+      if (m == tt_move) return std::numeric_limits<int>::max();
+      if (m == killers[0]) return std::numeric_limits<int>::max() - 1;
+      if (m == killers[1]) return std::numeric_limits<int>::max() - 2;
+      return history_[m];
+    };
+    std::stable_sort(moves.begin(), moves.end(), [&rank] (const Move a, const Move b) {
+      return rank(a) > rank(b);
+    });
+  }
+
+  void RememberCutoff(const Move m, const size_t depth, const size_t ply) {
+    auto& killers = killers_[ply];
+    if (killers[0] != m) {
+      killers[1] = killers[0];
+      killers[0] = m;
+    }
+    history_[m] += static_cast<int>(depth * depth);
+  }
+
+  std::chrono::milliseconds thinking_time_;
+  size_t max_depth_;
+  int aspiration_window_;
+  Evaluator evaluator_;
+  std::vector<Entry> table_;
+  std::array<std::array<Move, 2>, MaxPly> killers_;
+  std::array<int, MaxMoves> history_;
+  std::chrono::steady_clock::time_point start_time_;
+  bool aborted_;
+  std::ostream* stats_sink_;
+  SearchStats last_stats_;
+  SearchStats total_stats_;
+};
+
+}  // namespace player
@@ -0,0 +1,565 @@
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "alphabeta.hpp"
+#include "bitboard.hpp"
+#include "book.hpp"
+#include "dispatch.hpp"
+#include "display.hpp"
+#include "gomoku.hpp"
+#include "numa.hpp"
+#include "othello.hpp"
+#include "params.hpp"
+#include "pattern.hpp"
+#include "perf.hpp"
+#include "player.hpp"
+#include "record.hpp"
+
+// Plays a fixed amount of MCTS self-play work and reports the wall time it
+// took. Every game is seeded from (seed, game index) and every search is
+// bounded by iterations, so the moves are identical on every machine and for
+// any number of threads; the checksum printed at the end makes that easy to
+// verify before comparing timings.
+
+namespace {
+
+struct Options {
+  std::string game = "othello";
+  std::string players[2] = {"mcts", "mcts"};  // black/dark and white/light
+  std::string roots[2] = {"ucb", "ucb"};       // root policies of the MCTS players
+  size_t depth = 4;  // of the alpha-beta players
+  int size = 8;
+  size_t iterations = 1000;
+  size_t playouts = 1;
+  size_t symmetry = 0;
+  size_t games = 4;
+  size_t threads = 1;
+  size_t seed = 1;
+  double bias = .4;
+  double draw_reward = .5;
+  double margin = 0;
+  bool timing = false;
+  bool perf = false;  // hardware counters by search phase and board primitive
+  bool primitives = false;  // only times the board primitives
+  std::string tree;    // only times saving a search tree to this file and resuming from it
+  bool huge_pages = false;
+  std::string placement = "none";  // of threads and search trees: none, local or interleave
+  std::string record;  // writes the games to this file
+  std::string replay;  // only replays the games in this file
+  std::string book;    // opening book probed by both players
+  std::string params;  // tuned search constants, which override --bias and --margin
+  std::string patterns;  // pattern weights that score playouts cut short
+  size_t cutoff = 0;     // moves after which playouts are cut short
+};
+
+struct GameStats {
+  size_t moves;
+  size_t checksum;
+  player::SearchStats search;
+  std::vector<int> history;
+  uint8_t winner;
+};
+
+size_t Mix(const size_t h, const size_t v) {
+  // FNV-1a style mixing; only needs to be stable, not strong
+  return (h ^ v) * 1099511628211ull;
+}
+
+// loaded once and shared by all games and threads
+template<class GT>
+const book::Book<GT>* GetBook(const Options& opt) {
+  static book::Book<GT> book;
+  static const bool loaded = !opt.book.empty() && book.Load(opt.book.c_str());
+  return loaded ? &book : nullptr;
+}
+
+const util::Topology& GetTopology() {
+  static const util::Topology topology = util::Topology::Read();
+  return topology;
+}
+
+// the tuned constants for the game, size and iterations, if the table has them
+const player::SearchParams* GetParams(const Options& opt) {
+  static player::ParamTable table;
+  static player::SearchParams params;
+  static const bool found = !opt.params.empty() && table.Load(opt.params.c_str()) &&
+                            table.Find(opt.game, opt.size, false, opt.iterations, params);
+  return found ? &params : nullptr;
+}
+
+// The pattern evaluator is only defined for 8x8 othello.
+template<class GT>
+std::function<double(const typename GT::Board&)> GetEvaluator(const Options& opt) {
+  return nullptr;
+}
+
+template<>
+std::function<double(const othello::Board<8>&)> GetEvaluator<othello::GameTraits<8>>(const Options& opt) {
+  static othello::PatternEvaluator<8> evaluator;
+  static const bool loaded = !opt.patterns.empty() && evaluator.Load(opt.patterns.c_str());
+  if (!loaded) return nullptr;
+  return [] (const othello::Board<8>& board) { return evaluator.Evaluate(board); };
+}
+
+template<class GT, class Black, class White>
+void PlayGame(const Options& opt, Black& p1, White& p2, typename GT::GameResult& result) {
+  ui::NullDisplay display;
+  typename GT::Board b;
+  if (const auto* book = GetBook<GT>(opt)) {
+    player::WithBook<GT, Black> w1(*book, p1);
+    player::WithBook<GT, White> w2(*book, p2);
+    GT::Play(b, w1, w2, result, display);
+  } else {
+    GT::Play(b, p1, p2, result, display);
+  }
+}
+
+// Plays one game with the first engine against either of the second ones.
+template<class GT, class Black, class MCTS, class AlphaBeta>
+void PlayGame(const Options& opt, Black& p1, MCTS& mcts2, AlphaBeta* ab2,
+              typename GT::GameResult& result) {
+  if (ab2) {
+    PlayGame<GT>(opt, p1, *ab2, result);
+  } else {
+    PlayGame<GT>(opt, p1, mcts2, result);
+  }
+}
+
+template<class MCTS>
+typename MCTS::RootPolicy GetRootPolicy(const std::string& name) {
+  return name == "halving" ? MCTS::SEQUENTIAL_HALVING : name == "gumbel" ? MCTS::GUMBEL : MCTS::UCB;
+}
+
+template<class GT>
+GameStats PlayOne(const Options& opt, const size_t index) {
+  using MCTS = player::GenericMCTS<GT>;
+  using AlphaBeta = player::AlphaBeta<GT>;
+  std::seed_seq seq1{opt.seed, index, size_t{1}};
+  std::seed_seq seq2{opt.seed, index, size_t{2}};
+  std::mt19937 rng1(seq1);
+  std::mt19937 rng2(seq2);
+  MCTS mcts1(rng1, std::chrono::milliseconds(0));
+  MCTS mcts2(rng2, std::chrono::milliseconds(0));
+  std::unique_ptr<AlphaBeta> ab[2];
+  for (int i = 0; i < 2; ++i) {
+    MCTS& mcts = i ? mcts2 : mcts1;
+    mcts.SetBias(opt.bias);
+    mcts.SetRootPolicy(GetRootPolicy<MCTS>(opt.roots[i]));
+    mcts.SetMaxIterations(opt.iterations);
+    mcts.SetPlayoutsPerLeaf(opt.playouts);
+    mcts.SetSymmetryDepth(opt.symmetry);
+    mcts.SetDrawReward(opt.draw_reward);
+    mcts.SetMarginWeight(opt.margin);
+    if (const auto* params = GetParams(opt)) player::ApplyParams(*params, mcts);
+    mcts.SetPhaseTiming(opt.timing);
+    mcts.SetPerfCounters(opt.perf);
+    mcts.SetHugePages(opt.huge_pages);
+    mcts.SetInterleave(opt.placement == "interleave" ? GetTopology().node_mask() : 0);
+    mcts.SetPlayoutCutoff(opt.cutoff, GetEvaluator<GT>(opt));
+    if (opt.players[i] == "alphabeta") {
+      ab[i].reset(new AlphaBeta(std::chrono::milliseconds(0)));
+      ab[i]->SetMaxDepth(opt.depth);
+      if (auto evaluator = GetEvaluator<GT>(opt)) ab[i]->SetEvaluator(evaluator);
+    }
+  }
+  typename GT::GameResult result;
+  if (ab[0]) {
+    PlayGame<GT>(opt, *ab[0], mcts2, ab[1].get(), result);
+  } else {
+    PlayGame<GT>(opt, mcts1, mcts2, ab[1].get(), result);
+  }
+  GameStats stats{result.history.size(), 14695981039346656037ull,
+                  ab[0] ? ab[0]->total_stats() : mcts1.total_stats()};
+  stats.search.Merge(ab[1] ? ab[1]->total_stats() : mcts2.total_stats());
+  for (const auto& e : result.history) {
+    const int m = record::GetMove(e);
+    stats.checksum = Mix(stats.checksum, static_cast<size_t>(m));
+    stats.history.push_back(m);
+  }
+  stats.checksum = Mix(stats.checksum, result.winner);
+  stats.winner = result.winner;
+  return stats;
+}
+
+template<class GT>
+void WriteRecords(const Options& opt, const std::vector<GameStats>& stats) {
+  std::ofstream out(opt.record, std::ios::binary);
+  record::Writer<GT> writer(out, {opt.players[0], opt.players[1]});
+  for (size_t i = 0; i < stats.size(); ++i) {
+    writer.Write(record::GameInfo{{opt.seed, i}, {0, 1}, stats[i].winner}, stats[i].history);
+  }
+}
+
+template<class GT>
+int ReplayRecords(const Options& opt) {
+  util::MappedFile file(opt.replay.c_str());
+  if (!file.ok()) {
+    std::cerr << "Cannot read " << opt.replay << std::endl;
+    return 1;
+  }
+  const auto start_time = std::chrono::high_resolution_clock::now();
+  record::Reader<GT> reader(file.data(), file.size());
+  if (!reader.ok()) {
+    std::cerr << opt.replay << " is not a " << GT::GetGameName() << " record file" << std::endl;
+    return 1;
+  }
+  record::Record<GT> r;
+  size_t games = 0;
+  size_t moves = 0;
+  size_t checksum = 14695981039346656037ull;
+  while (reader.Next(r)) {
+    typename GT::Board b;
+    record::Replay(r, b);
+    ++games;
+    moves += r.num_moves;
+    checksum = Mix(checksum, b.winner());
+  }
+  const auto end_time = std::chrono::high_resolution_clock::now();
+  const auto t = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time).count() / 1000000.0;
+  std::cout << "Games = " << games << std::endl
+            << "Moves = " << moves << std::endl
+            << "Checksum = " << std::hex << checksum << std::dec << std::endl
+            << "Time = " << t << " sec" << std::endl
+            << "Throughput = " << games * 60 / t << " games/min" << std::endl;
+  return 0;
+}
+
+void PrintUnavailable(const util::PerfCounters& counters) {
+  const int e = counters.error();
+  std::cout << "Counters = unavailable (" << std::strerror(e)
+            << (e == EACCES || e == EPERM ? "; see /proc/sys/kernel/perf_event_paranoid" : "") << ")" << std::endl;
+}
+
+// one line of counts per call, e.g. per iteration of a phase
+void PrintCounts(const char* name, const util::PerfCounters::Values& c, const double calls) {
+  using util::PerfCounters;
+  std::cout << "  " << name << ":";
+  for (int e = 0; e < PerfCounters::NumEvents; ++e) {
+    std::cout << " " << PerfCounters::GetName(static_cast<PerfCounters::Event>(e)) << "=" << c[e] / calls;
+  }
+  std::cout << " ipc=" << (c[PerfCounters::CYCLES] ? static_cast<double>(c[PerfCounters::INSTRUCTIONS]) / c[PerfCounters::CYCLES] : 0)
+            << std::endl;
+}
+
+// BenchPrimitives tells when the counters are unavailable.
+void PrintCounters(const player::SearchStats& s) {
+  if (!s.HasCounters()) return;
+  const double n = util::at_least_1(s.iterations);
+  std::cout << "Counters per iteration:" << std::endl;
+  PrintCounts("select", s.select_counters, n);
+  PrintCounts("expand", s.expand_counters, n);
+  PrintCounts("simulate", s.simulate_counters, n);
+  PrintCounts("backprop", s.backprop_counters, n);
+}
+
+// Nothing to compare with where the game has no bitboard.
+template<class Position, class Move, class F>
+void BenchBitBoard(const std::vector<Position>&, const std::vector<Move>&, const size_t, F&, size_t&) {}
+
+// BitBoard::Play and GetMoves on the same positions as Board, for othello
+// boards of any supported size.
+template<othello::BoardSize N, class F>
+void BenchBitBoard(const std::vector<othello::Board<N>>& positions, const std::vector<othello::Move>& moves,
+                   const size_t rounds, F& measure, size_t& sink) {
+  using BitBoard = othello::BitBoard<N>;
+  std::vector<BitBoard> bits;
+  for (const auto& b : positions) bits.push_back(BitBoard::FromBoard(b));
+  measure("BitBoard::Play", [&] {
+    for (size_t r = 0; r < rounds; ++r) {
+      for (size_t i = 0; i < bits.size(); ++i) {
+        BitBoard b = bits[i];
+        b.Play(moves[i]);
+        sink += b.empties();
+      }
+    }
+  });
+  measure("BitBoard::GetMoves", [&] {
+    for (size_t r = 0; r < rounds; ++r) {
+      for (const auto& b : bits) sink += othello::PopCount(b.GetMoves());
+    }
+  });
+}
+
+// Times the board primitives one at a time, on positions of random games:
+// Next on a copy of the board (which includes CheckWinner in gomoku), and
+// GetLegalMoves, then their BitBoard counterparts in othello. With --perf,
+// counts hardware events too.
+template<class GT>
+void BenchPrimitives(const Options& opt) {
+  using Board = typename GT::Board;
+  std::mt19937 rng(opt.seed);
+  player::Random<GT> random(rng);
+  std::vector<Board> positions;
+  std::vector<typename GT::Move> moves;
+  while (positions.size() < 10000) {
+    Board b;
+    while (!b.IsFinished()) {
+      positions.push_back(b);
+      moves.push_back(random.GetNextMove(b, typename GT::History()));
+      b.Next(moves.back());
+    }
+  }
+  util::PerfCounters counters;
+  if (opt.perf && !counters.Open()) PrintUnavailable(counters);
+  const size_t rounds = 100;
+  const double calls = static_cast<double>(rounds) * positions.size();
+  size_t sink = 0;
+  auto measure = [&counters, calls] (const char* name, const std::function<void()>& f) {
+    util::PerfCounters::Values before, after, c{};
+    const auto start_time = std::chrono::high_resolution_clock::now();
+    counters.Read(before);
+    f();
+    counters.Read(after);
+    const auto t = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::high_resolution_clock::now() - start_time).count();
+    util::AddDifference(c, after, before);
+    std::cout << "  " << name << ": " << t / calls << " ns/call" << std::endl;
+    if (counters.ok()) PrintCounts(name, c, calls);
+  };
+  std::cout << "Board primitives (" << positions.size() << " positions):" << std::endl;
+  measure("Next", [&] {
+    for (size_t r = 0; r < rounds; ++r) {
+      for (size_t i = 0; i < positions.size(); ++i) {
+        Board b = positions[i];
+        b.Next(moves[i]);
+        sink += b.current_player();
+      }
+    }
+  });
+  measure("GetLegalMoves", [&] {
+    for (size_t r = 0; r < rounds; ++r) {
+      for (const auto& b : positions) sink += b.GetLegalMoves().size();
+    }
+  });
+  BenchBitBoard(positions, moves, rounds, measure, sink);
+  std::cout << "  (checksum " << sink << ")" << std::endl;
+}
+
+// Searches the starting position, saves the tree to --tree, and resumes the
+// search from the file in a fresh engine, as a restarted process would.
+template<class GT>
+int BenchTree(const Options& opt) {
+  using Clock = std::chrono::high_resolution_clock;
+  using MCTS = player::GenericMCTS<GT>;
+  auto ms = [] (const Clock::duration d) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(d).count() / 1000.0;
+  };
+  std::mt19937 rng1(opt.seed);
+  std::mt19937 rng2(opt.seed + 1);
+  MCTS mcts1(rng1, std::chrono::milliseconds(0));
+  MCTS mcts2(rng2, std::chrono::milliseconds(0));
+  for (auto* mcts : {&mcts1, &mcts2}) {
+    mcts->SetBias(opt.bias);
+    mcts->SetMaxIterations(opt.iterations);
+    if (const auto* params = GetParams(opt)) player::ApplyParams(*params, *mcts);
+  }
+  const typename GT::Board board;
+  const typename GT::History history;
+  mcts1.GetNextMove(board, history);
+  const auto save_start = Clock::now();
+  if (!mcts1.SaveTree(opt.tree.c_str())) {
+    std::cerr << "Cannot write " << opt.tree << std::endl;
+    return 1;
+  }
+  const auto save_time = Clock::now() - save_start;
+  const auto load_start = Clock::now();
+  if (!mcts2.LoadTree(opt.tree.c_str())) {
+    std::cerr << "Cannot read " << opt.tree << std::endl;
+    return 1;
+  }
+  const auto load_time = Clock::now() - load_start;
+  const size_t loaded = mcts2.root_visits();
+  mcts2.GetNextMove(board, history);
+  std::cout << "Game = " << opt.game << std::endl
+            << "Size = " << opt.size << std::endl
+            << "Iterations per search = " << opt.iterations << std::endl
+            << "Tree = " << mcts1.last_stats().nodes << " nodes, "
+            << util::MappedFile(opt.tree.c_str()).size() << " bytes" << std::endl
+            << "Save = " << ms(save_time) << " ms" << std::endl
+            << "Load = " << ms(load_time) << " ms" << std::endl
+            << "Root visits = " << mcts1.root_visits() << " saved, " << loaded << " loaded, "
+            << mcts2.root_visits() << " after resuming" << std::endl;
+  return 0;
+}
+
+template<class GT>
+int PlayGames(const Options& opt) {
+  if (!opt.patterns.empty() && !GetEvaluator<GT>(opt)) {
+    std::cerr << "Cannot read " << static_cast<int>(GT::MaxPos) << "x" << static_cast<int>(GT::MaxPos)
+              << " " << GT::GetGameName()
+              << " pattern weights from " << opt.patterns << std::endl;
+    return 1;
+  }
+  std::cout << "Game = " << opt.game << std::endl
+            << "Size = " << opt.size << std::endl
+            << "Players = " << opt.players[0] << "," << opt.players[1] << std::endl
+            << "Root policies = " << opt.roots[0] << "," << opt.roots[1] << std::endl
+            << "Iterations per move = " << opt.iterations << std::endl
+            << "Playouts per leaf = " << opt.playouts << std::endl
+            << "Games = " << opt.games << std::endl
+            << "Threads = " << opt.threads << std::endl
+            << "Placement = " << opt.placement << " (" << GetTopology().num_nodes() << " nodes)" << std::endl
+            << "Seed = " << opt.seed << std::endl;
+  if (const auto* params = GetParams(opt)) {
+    std::cout << "Params = bias " << params->bias << ", margin " << params->margin_weight
+              << " (" << opt.params << ")" << std::endl;
+  }
+
+  std::vector<GameStats> stats(opt.games);
+  const auto start_time = std::chrono::high_resolution_clock::now();
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < opt.threads; ++t) {
+    threads.emplace_back([&opt, &stats, t] {
+      // pinned threads fill their search trees from their own node, unless
+      // the trees are interleaved
+      if (opt.placement != "none") util::PinThread(GetTopology().GetCpu(t));
+      for (size_t i = t; i < opt.games; i += opt.threads) {
+        stats[i] = PlayOne<GT>(opt, i);
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  const auto end_time = std::chrono::high_resolution_clock::now();
+
+  // combine in game order so that the checksum does not depend on scheduling
+  size_t moves = 0;
+  size_t checksum = 14695981039346656037ull;
+  player::SearchStats search;
+  size_t wins[3] = {0, 0, 0};  // first player, second player, draws
+  const auto first = typename GT::Board().current_player();
+  for (const auto& s : stats) {
+    moves += s.moves;
+    checksum = Mix(checksum, s.checksum);
+    search.Merge(s.search);
+    ++wins[s.winner == first ? 0 : s.winner ? 1 : 2];
+  }
+  const auto t = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time).count() / 1000000.0;
+  std::cout << "Moves = " << moves << std::endl
+            << "Checksum = " << std::hex << checksum << std::dec << std::endl
+            << "Wins = " << wins[0] << " " << wins[1] << " (draws " << wins[2] << ")" << std::endl
+            << "Time = " << t << " sec" << std::endl
+            << "Throughput = " << search.iterations / t << " iter/s, "
+            << search.playouts / t << " playouts/s, "
+            << search.nodes / t << " nodes/s" << std::endl
+            << "Stats = ";
+  search.WriteJson(std::cout);
+  std::cout << std::endl;
+  if (opt.perf) {
+    PrintCounters(search);
+    BenchPrimitives<GT>(opt);
+  }
+  if (!opt.record.empty()) WriteRecords<GT>(opt, stats);
+  return 0;
+}
+
+// Runs the benchmark on the game and board size chosen on the command line.
+struct Bench {
+  template<class GT>
+  void Run() {
+    if (opt.primitives) {
+      BenchPrimitives<GT>(opt);
+      status = 0;
+    } else if (!opt.tree.empty()) {
+      status = BenchTree<GT>(opt);
+    } else {
+      status = opt.replay.empty() ? PlayGames<GT>(opt) : ReplayRecords<GT>(opt);
+    }
+  }
+
+  const Options& opt;
+  int status;
+};
+
+bool ParseOption(Options& opt, const char* arg) {
+  const char* eq = std::strchr(arg, '=');
+  if (std::strncmp(arg, "--", 2) != 0 || !eq) return false;
+  const std::string key(arg + 2, eq);
+  const char* value = eq + 1;
+  if (key == "game") return dispatch::ParseGame(value, opt.game, opt.size);
+  if (key == "players") {
+    const char* comma = std::strchr(value, ',');
+    if (!comma) return false;
+    opt.players[0].assign(value, comma);
+    opt.players[1] = comma + 1;
+    for (const auto& p : opt.players) {
+      if (p != "mcts" && p != "alphabeta") return false;
+    }
+    return true;
+  }
+  if (key == "root") {
+    // one policy for both players, or one each
+    const char* comma = std::strchr(value, ',');
+    opt.roots[0].assign(value, comma ? comma : value + std::strlen(value));
+    opt.roots[1] = comma ? comma + 1 : opt.roots[0];
+    for (const auto& r : opt.roots) {
+      if (r != "ucb" && r != "halving" && r != "gumbel") return false;
+    }
+    return true;
+  }
+  if (key == "iterations") opt.iterations = std::strtoul(value, nullptr, 10);
+  else if (key == "depth") opt.depth = std::strtoul(value, nullptr, 10);
+  else if (key == "playouts") opt.playouts = std::strtoul(value, nullptr, 10);
+  else if (key == "symmetry") opt.symmetry = std::strtoul(value, nullptr, 10);
+  else if (key == "games") opt.games = std::strtoul(value, nullptr, 10);
+  else if (key == "threads") opt.threads = std::strtoul(value, nullptr, 10);
+  else if (key == "seed") opt.seed = std::strtoul(value, nullptr, 10);
+  else if (key == "bias") opt.bias = std::strtod(value, nullptr);
+  else if (key == "draw-reward") opt.draw_reward = std::strtod(value, nullptr);
+  else if (key == "margin") opt.margin = std::strtod(value, nullptr);
+  else if (key == "timing") opt.timing = std::strtoul(value, nullptr, 10) != 0;
+  else if (key == "perf") opt.perf = std::strtoul(value, nullptr, 10) != 0;
+  else if (key == "primitives") opt.primitives = std::strtoul(value, nullptr, 10) != 0;
+  else if (key == "huge-pages") opt.huge_pages = std::strtoul(value, nullptr, 10) != 0;
+  else if (key == "placement") {
+    opt.placement = value;
+    return opt.placement == "none" || opt.placement == "local" || opt.placement == "interleave";
+  }
+  else if (key == "record") opt.record = value;
+  else if (key == "replay") opt.replay = value;
+  else if (key == "tree") opt.tree = value;
+  else if (key == "book") opt.book = value;
+  else if (key == "params") opt.params = value;
+  else if (key == "patterns") opt.patterns = value;
+  else if (key == "cutoff") opt.cutoff = std::strtoul(value, nullptr, 10);
+  else return false;
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options opt;
+  for (int i = 1; i < argc; ++i) {
+    if (!ParseOption(opt, argv[i])) {
+      std::cerr << "usage: " << argv[0]
+                << " [--game=gomoku|othello[:SIZE]] [--players=mcts|alphabeta,mcts|alphabeta]"
+                << " [--iterations=N] [--playouts=N] [--depth=N] [--root=ucb|halving|gumbel[,...]]"
+                << " [--symmetry=DEPTH] [--games=N]"
+                << " [--threads=N] [--seed=N] [--bias=X] [--draw-reward=X] [--margin=W] [--timing=0|1] [--perf=0|1] [--primitives=0|1] [--huge-pages=0|1]"
+                << " [--placement=none|local|interleave]"
+                << " [--record=FILE] [--replay=FILE] [--tree=FILE] [--book=FILE] [--params=FILE]"
+                << " [--patterns=FILE] [--cutoff=MOVES]" << std::endl;
+      return 1;
+    }
+  }
+  opt.iterations = util::at_least_1(opt.iterations);
+  opt.playouts = util::at_least_1(opt.playouts);
+  opt.depth = util::at_least_1(opt.depth);
+  opt.threads = util::at_least_1(opt.threads);
+  Bench bench{opt, 0};
+  if (!dispatch::Run(opt.game, opt.size, bench)) {
+    std::cerr << "Unsupported " << opt.game << " board size " << opt.size
+              << "; supported sizes are " << dispatch::GetSupportedSizes(opt.game) << std::endl;
+    return 1;
+  }
+  return bench.status;
+}
@@ -0,0 +1,156 @@
+#pragma once
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include "othello.hpp"
+
+namespace othello {
+
+// the bit operations BitBoard needs, for both widths of its bit sets
+inline int PopCount(const uint64_t x) { return __builtin_popcountll(x); }
+
+inline int PopCount(const unsigned __int128 x) {
+  return __builtin_popcountll(static_cast<uint64_t>(x)) + __builtin_popcountll(static_cast<uint64_t>(x >> 64));
+}
+
+// the index of the lowest set bit of x != 0
+inline int FirstBit(const uint64_t x) { return __builtin_ctzll(x); }
+
+inline int FirstBit(const unsigned __int128 x) {
+  const uint64_t low = static_cast<uint64_t>(x);
+  return low ? __builtin_ctzll(low) : 64 + __builtin_ctzll(static_cast<uint64_t>(x >> 64));
+}
+
+// 64 bits that depend on every bit of x
+inline uint64_t Fold(const uint64_t x) { return x; }
+
+inline uint64_t Fold(const unsigned __int128 x) {
+  return static_cast<uint64_t>(x) ^ static_cast<uint64_t>(x >> 64) * 0xc2b2ae3d27d4eb4full;
+}
+
+// An othello position as two bit sets, the discs of the player to move and
+// those of the opponent, with bit i * N + j for the cell (i + 1, j + 1) as in
+// Board::GetMove. Moves and flips are computed for all cells of a direction
+// at once with shifts, which makes it much faster than Board for searches
+// that do not need the cell states Board keeps. Boards up to 8x8 fit in 64
+// bits; larger ones up to 10x10 use 128-bit integers.
+template<BoardSize N>
+class BitBoard {
+  static_assert(N * N <= 128 && N <= 10, "N must be <= 10");
+
+ public:
+  using Bits = typename std::conditional<N * N <= 64, uint64_t, unsigned __int128>::type;
+  static constexpr int NumDirections = 8;
+
+  BitBoard() : own_(0), opp_(0) {}
+  BitBoard(const Bits own, const Bits opp) : own_(own), opp_(opp) {}
+
+  // The discs of board, with its player to move (dark once finished) first.
+  static BitBoard FromBoard(const Board<N>& board) {
+    const Player p = board.IsFinished() ? DARK : board.current_player();
+    BitBoard b;
+    board.ForEachStone([&b, p] (const Move m, const CellValue v) {
+      (v == p ? b.own_ : b.opp_) |= Bits{1} << m;
+    });
+    return b;
+  }
+
+  static BitBoard GetStartingPosition() { return FromBoard(Board<N>()); }
+
+  Bits own() const { return own_; }
+  Bits opp() const { return opp_; }
+  Bits empty() const { return ~(own_ | opp_) & Full(); }
+  int empties() const { return PopCount(empty()); }
+
+  // disc difference for the player to move
+  int GetDifference() const { return PopCount(own_) - PopCount(opp_); }
+
+  // the cells where the player to move may play
+  Bits GetMoves() const {
+    const Bits e = empty();
+    Bits moves = 0;
+    for (int d = 0; d < NumDirections; ++d) {
+      moves |= Shift(Fill(Shift(own_, d) & opp_, opp_, d), d) & e;
+    }
+    return moves;
+  }
+
+  // the opponent's discs that playing m flips
+  Bits GetFlips(const int m) const {
+    Bits flips = 0;
+    for (int d = 0; d < NumDirections; ++d) {
+      const Bits f = Fill(Shift(Bits{1} << m, d) & opp_, opp_, d);
+      if (Shift(f, d) & own_) flips |= f;
+    }
+    return flips;
+  }
+
+  // Plays m for the player to move, who then becomes the opponent.
+  void Play(const int m) {
+    const Bits flips = GetFlips(m);
+    own_ |= flips | Bits{1} << m;
+    opp_ &= ~flips;
+    Pass();
+  }
+
+  void Pass() { std::swap(own_, opp_); }
+
+  uint64_t GetKey() const {
+    // a strong mix, so that the low bits index a table
+    uint64_t h = Fold(own_) * 0x9e3779b97f4a7c15ull ^ (Fold(opp_) + 0x632be59bd9b4e019ull) * 0xbf58476d1ce4e5b9ull;
+    h ^= h >> 31;
+    h *= 0x94d049bb133111ebull;
+    return h ^ (h >> 29);
+  }
+
+  bool operator==(const BitBoard& o) const { return own_ == o.own_ && opp_ == o.opp_; }
+  bool operator<(const BitBoard& o) const { return own_ < o.own_ || (own_ == o.own_ && opp_ < o.opp_); }
+
+ private:
+  static constexpr Bits Full() { return N * N == sizeof(Bits) * 8 ? ~Bits{0} : (Bits{1} << (N * N)) - 1; }
+
+  static constexpr Bits Column(const int j, const int i = 0) {
+    return i == N ? 0 : Bits{1} << (i * N + j) | Column(j, i + 1);
+  }
+
+  static constexpr Bits NotFirstColumn() { return Full() & ~Column(0); }
+  static constexpr Bits NotLastColumn() { return Full() & ~Column(N - 1); }
+
+  // cells that a shift in direction d may reach without wrapping around a row
+  static Bits GetShiftMask(const int d) {
+    switch (d) {
+      case 0: case 4: case 7: return NotFirstColumn();
+      case 1: case 5: case 6: return NotLastColumn();
+      default: return Full();
+    }
+  }
+
+  // moves every bit k cells in direction d, keeping those that land on the
+  // cells of mask
+  static Bits Shift(const Bits x, const int d, const int k, const Bits mask) {
+    static const int steps[NumDirections] = {1, -1, N, -N, N + 1, -(N + 1), N - 1, -(N - 1)};
+    const int s = steps[d] * k;
+    return (s > 0 ? x << s : x >> -s) & mask;
+  }
+
+  // moves every bit one cell in direction d, dropping the ones that leave the board
+  static Bits Shift(const Bits x, const int d) { return Shift(x, d, 1, GetShiftMask(d)); }
+
+  // x and the cells of p that continue its runs in direction d, for runs of
+  // up to 8 cells, in three doubling steps (a Kogge-Stone fill) instead of a
+  // step per cell
+  static Bits Fill(Bits x, Bits p, const int d) {
+    const Bits mask = GetShiftMask(d);
+    p &= mask;
+    x |= p & Shift(x, d, 1, mask);
+    p &= Shift(p, d, 1, mask);
+    x |= p & Shift(x, d, 2, mask);
+    p &= Shift(p, d, 2, mask);
+    return x | (p & Shift(x, d, 4, mask));
+  }
+
+  Bits own_;
+  Bits opp_;
+};
+
+}  // namespace othello
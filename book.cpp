@@ -0,0 +1,177 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "book.hpp"
+#include "dispatch.hpp"
+#include "gomoku.hpp"
+#include "othello.hpp"
+#include "player.hpp"
+#include "record.hpp"
+#include "symmetry.hpp"
+
+// Builds an opening book. The positions come from the first plies of
+// self-play games (see bench --record), and each position played often
+// enough is searched once, deeply, so that players never have to search it
+// again.
+
+namespace {
+
+struct Options {
+  std::string game = "othello";
+  int size = 8;
+  std::string records;  // comma separated record files
+  std::string out = "book.bin";
+  size_t plies = 8;
+  size_t min_count = 2;
+  size_t max_positions = 1000;
+  size_t iterations = 100000;
+  size_t threads = 1;
+  size_t seed = 1;
+  double bias = .4;
+};
+
+template<class GT>
+int Build(const Options& opt) {
+  using Board = typename GT::Board;
+  using Move = typename GT::Move;
+  struct Position {
+    Board board;
+    size_t count;
+  };
+  std::map<uint64_t, Position> positions;
+  auto add = [&positions] (const Board& board) {
+    const auto key = symmetry::GetCanonicalKey<GT>(board).key;
+    auto it = positions.find(key);
+    if (it == positions.end()) {
+      positions.insert(std::make_pair(key, Position{board, 1}));
+    } else {
+      ++it->second.count;
+    }
+  };
+
+  size_t games = 0;
+  std::istringstream paths(opt.records);
+  std::string path;
+  while (std::getline(paths, path, ',')) {
+    if (path.empty()) continue;
+    util::MappedFile file(path.c_str());
+    record::Reader<GT> reader(file.data(), file.size());
+    if (!file.ok() || !reader.ok()) {
+      std::cerr << "Cannot read " << GT::GetGameName() << " records from " << path << std::endl;
+      return 1;
+    }
+    record::Record<GT> r;
+    while (reader.Next(r)) {
+      Board b;
+      size_t ply = 0;
+      record::Replay(r, b, [&add, &ply, &opt] (const Board& board, const Move m) {
+        if (ply++ < opt.plies) add(board);
+      });
+      ++games;
+    }
+  }
+
+  // the starting position is always searched; the rest by popularity
+  std::vector<Position> selected;
+  const Board start;
+  const auto start_key = symmetry::GetCanonicalKey<GT>(start).key;
+  for (const auto& p : positions) {
+    if (p.first == start_key || p.second.count >= opt.min_count) selected.push_back(p.second);
+  }
+  if (positions.find(start_key) == positions.end()) selected.push_back(Position{start, 1});
+  std::stable_sort(selected.begin(), selected.end(), [] (const Position& a, const Position& b) {
+    return a.count > b.count;
+  });
+  if (selected.size() > opt.max_positions) selected.resize(opt.max_positions);
+  std::cout << "Games = " << games << std::endl
+            << "Positions = " << positions.size() << std::endl
+            << "Selected = " << selected.size() << std::endl;
+
+  std::vector<Move> moves(selected.size());
+  std::vector<float> values(selected.size());
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < opt.threads; ++t) {
+    threads.emplace_back([&, t] {
+      for (size_t i = t; i < selected.size(); i += opt.threads) {
+        std::seed_seq seq{opt.seed, i};
+        std::mt19937 rng(seq);
+        player::GenericMCTS<GT> mcts(rng, std::chrono::milliseconds(0));
+        mcts.SetBias(opt.bias);
+        mcts.SetMaxIterations(opt.iterations);
+        moves[i] = mcts.GetNextMove(selected[i].board, typename GT::History());
+        values[i] = mcts.last_stats().value;
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  book::Builder<GT> builder;
+  for (size_t i = 0; i < selected.size(); ++i) {
+    builder.Add(selected[i].board, moves[i], std::min<size_t>(selected[i].count, 0xffff), values[i]);
+  }
+  if (!builder.Write(opt.out.c_str())) {
+    std::cerr << "Cannot write " << opt.out << std::endl;
+    return 1;
+  }
+  std::cout << "Entries = " << builder.size() << std::endl;
+  return 0;
+}
+
+struct BuildBook {
+  template<class GT>
+  void Run() { status = Build<GT>(opt); }
+
+  const Options& opt;
+  int status;
+};
+
+bool ParseOption(Options& opt, const char* arg) {
+  const char* eq = std::strchr(arg, '=');
+  if (std::strncmp(arg, "--", 2) != 0 || !eq) return false;
+  const std::string key(arg + 2, eq);
+  const char* value = eq + 1;
+  if (key == "game") return dispatch::ParseGame(value, opt.game, opt.size);
+  if (key == "records") opt.records = value;
+  else if (key == "out") opt.out = value;
+  else if (key == "plies") opt.plies = std::strtoul(value, nullptr, 10);
+  else if (key == "min-count") opt.min_count = std::strtoul(value, nullptr, 10);
+  else if (key == "max-positions") opt.max_positions = std::strtoul(value, nullptr, 10);
+  else if (key == "iterations") opt.iterations = std::strtoul(value, nullptr, 10);
+  else if (key == "threads") opt.threads = std::strtoul(value, nullptr, 10);
+  else if (key == "seed") opt.seed = std::strtoul(value, nullptr, 10);
+  else if (key == "bias") opt.bias = std::strtod(value, nullptr);
+  else return false;
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options opt;
+  for (int i = 1; i < argc; ++i) {
+    if (!ParseOption(opt, argv[i])) {
+      std::cerr << "usage: " << argv[0]
+                << " [--game=gomoku|othello[:SIZE]] [--records=FILE,...] [--out=FILE]"
+                << " [--plies=N] [--min-count=N] [--max-positions=N]"
+                << " [--iterations=N] [--threads=N] [--seed=N] [--bias=X]" << std::endl;
+      return 1;
+    }
+  }
+  opt.iterations = util::at_least_1(opt.iterations);
+  opt.threads = util::at_least_1(opt.threads);
+  BuildBook build{opt, 0};
+  if (!dispatch::Run(opt.game, opt.size, build)) {
+    std::cerr << "Unsupported " << opt.game << " board size " << opt.size
+              << "; supported sizes are " << dispatch::GetSupportedSizes(opt.game) << std::endl;
+    return 1;
+  }
+  return build.status;
+}
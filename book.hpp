@@ -0,0 +1,156 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "symmetry.hpp"
+#include "util.hpp"
+
+namespace book {
+
+// One book move, with the move in the canonical orientation of the position.
+struct Entry {
+  uint64_t key;
+  int16_t move;
+  uint16_t weight;  // how much the entry is trusted, e.g. the number of games
+  float value;      // estimated winning rate of the move
+};
+static_assert(sizeof(Entry) == 16, "Entry must be packed");
+
+// File layout: "MGBK" version:u8 board_size:u8 reserved:u16 game:char[8]
+// num_entries:u64, then the entries sorted by key, in native byte order.
+struct FileHeader {
+  char magic[4];
+  uint8_t version;
+  uint8_t board_size;
+  uint16_t reserved;
+  char game[8];
+  uint64_t num_entries;
+};
+static_assert(sizeof(FileHeader) == 24, "FileHeader must be packed");
+
+constexpr const uint8_t Version = 2;
+
+// An opening book mapped from a file. Probing is a binary search over the
+// mapped entries, so loading costs nothing until the pages are touched.
+template<class GameTraits>
+class Book {
+ public:
+  using Board = typename GameTraits::Board;
+  using Move = typename GameTraits::Move;
+
+  Book() : entries_(nullptr), num_entries_(0) {}
+
+  bool Load(const char* path) {
+    std::unique_ptr<util::MappedFile> file(new util::MappedFile(path));
+    entries_ = nullptr;
+    num_entries_ = 0;
+    if (!file->ok() || file->size() < sizeof(FileHeader)) return false;
+    FileHeader h;
+    std::memcpy(&h, file->data(), sizeof(h));
+    if (std::memcmp(h.magic, "MGBK", 4) != 0 || h.version != Version ||
+        h.board_size != GameTraits::MaxPos ||
+        std::strncmp(h.game, GameTraits::GetGameName(), sizeof(h.game)) != 0 ||
+        h.num_entries > (file->size() - sizeof(FileHeader)) / sizeof(Entry)) {
+      return false;
+    }
+    file_ = std::move(file);
+    entries_ = reinterpret_cast<const Entry*>(file_->data() + sizeof(FileHeader));
+    num_entries_ = h.num_entries;
+    return true;
+  }
+
+  size_t size() const { return num_entries_; }
+
+  // Returns the book move for the position, or the illegal move if there is
+  // none.
+  Move Probe(const Board& board) const {
+    if (!num_entries_ || board.IsFinished()) return GameTraits::GetIllegalMove();
+    const auto ck = symmetry::GetCanonicalKey<GameTraits>(board);
+    const Entry* end = entries_ + num_entries_;
+    const Entry* e = std::lower_bound(entries_, end, ck.key, [] (const Entry& a, const uint64_t k) {
+      return a.key < k;
+    });
+    if (e == end || e->key != ck.key) return GameTraits::GetIllegalMove();
+    const Move m = symmetry::InverseTransformCell(ck.transform, e->move, GameTraits::MaxPos);
+    return board.IsLegalMove(m) ? m : GameTraits::GetIllegalMove();
+  }
+
+ private:
+  std::unique_ptr<util::MappedFile> file_;
+  const Entry* entries_;
+  size_t num_entries_;
+};
+
+// Collects book moves and writes them as a book file.
+template<class GameTraits>
+class Builder {
+ public:
+  using Board = typename GameTraits::Board;
+  using Move = typename GameTraits::Move;
+
+  size_t size() const { return entries_.size(); }
+
+  // Adds a move for the position, replacing any entry with a lower weight.
+  void Add(const Board& board, const Move m, const uint16_t weight, const float value) {
+    const auto ck = symmetry::GetCanonicalKey<GameTraits>(board);
+    const int16_t cm = symmetry::TransformCell(ck.transform, m, GameTraits::MaxPos);
+    auto it = entries_.find(ck.key);
+    if (it == entries_.end() || it->second.weight < weight) {
+      entries_[ck.key] = Entry{ck.key, cm, weight, value};
+    }
+  }
+
+  bool Write(const char* path) const {
+    FileHeader h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, "MGBK", 4);
+    h.version = Version;
+    h.board_size = GameTraits::MaxPos;
+    std::strncpy(h.game, GameTraits::GetGameName(), sizeof(h.game));
+    h.num_entries = entries_.size();
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    for (const auto& e : entries_) {  // std::map iterates in key order
+      out.write(reinterpret_cast<const char*>(&e.second), sizeof(Entry));
+    }
+    return static_cast<bool>(out);
+  }
+
+ private:
+  std::map<uint64_t, Entry> entries_;
+};
+
+}  // namespace book
+
+namespace player {
+
+// Plays book moves while the position is in the book, and asks the engine
+// otherwise.
+template<class GameTraits, class Engine>
+class WithBook {
+ public:
+  using Board = typename GameTraits::Board;
+  using Move = typename GameTraits::Move;
+  using History = typename GameTraits::History;
+
+  WithBook(const book::Book<GameTraits>& book, Engine& engine) : book_(book), engine_(engine) {}
+
+  const char* GetName() const { return engine_.GetName(); }
+
+  Move GetNextMove(const Board& board, const History& history) {
+    const Move m = book_.Probe(board);
+    return m != GameTraits::GetIllegalMove() ? m : engine_.GetNextMove(board, history);
+  }
+
+ private:
+  const book::Book<GameTraits>& book_;
+  Engine& engine_;
+};
+
+}  // namespace player
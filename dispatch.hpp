@@ -0,0 +1,71 @@
+#pragma once
+#include <cstdlib>
+#include <string>
+#include "gomoku.hpp"
+#include "othello.hpp"
+
+namespace dispatch {
+
+// Board sizes compiled into the binaries. Each size is a separate
+// instantiation of the game and of everything run on it, so the search loops
+// stay specialized for the size; only the choice among them is made at run
+// time.
+template<int... Ns>
+struct Sizes {};
+
+using GomokuSizes = Sizes<9, 11, 13, 15, 19>;
+using OthelloSizes = Sizes<4, 6, 8, 10>;
+
+inline int GetDefaultSize(const std::string& game) {
+  return game == "gomoku" ? 11 : 8;
+}
+
+template<int N, int... Ns>
+std::string ToString(Sizes<N, Ns...>) {
+  const int sizes[] = {N, Ns...};
+  std::string s;
+  for (const int n : sizes) s += (s.empty() ? "" : ",") + std::to_string(n);
+  return s;
+}
+
+inline std::string GetSupportedSizes(const std::string& game) {
+  return game == "gomoku" ? ToString(GomokuSizes()) : ToString(OthelloSizes());
+}
+
+template<template<uint8_t> class Traits, class F>
+bool RunSize(Sizes<>, const int n, F& f) {
+  return false;
+}
+
+template<template<uint8_t> class Traits, int N, int... Ns, class F>
+bool RunSize(Sizes<N, Ns...>, const int n, F& f) {
+  if (n != N) return RunSize<Traits>(Sizes<Ns...>(), n, f);
+  f.template Run<Traits<N>>();
+  return true;
+}
+
+// Calls f.template Run<GameTraits>() with the traits of the given game and
+// board size. Returns false if the game or the size is not compiled in.
+template<class F>
+bool Run(const std::string& game, const int n, F& f) {
+  if (game == "gomoku") return RunSize<gomoku::GameTraits>(GomokuSizes(), n, f);
+  if (game == "othello") return RunSize<othello::GameTraits>(OthelloSizes(), n, f);
+  return false;
+}
+
+// Splits a game argument such as "othello" or "othello:6" into the game and
+// its board size, the default size if none is given.
+inline bool ParseGame(const std::string& arg, std::string& game, int& n) {
+  const auto colon = arg.find(':');
+  game = arg.substr(0, colon);
+  if (game != "gomoku" && game != "othello") return false;
+  if (colon == std::string::npos) {
+    n = GetDefaultSize(game);
+    return true;
+  }
+  char* end;
+  n = std::strtol(arg.c_str() + colon + 1, &end, 10);
+  return *end == '\0' && end != arg.c_str() + colon + 1;
+}
+
+}  // namespace dispatch
@@ -0,0 +1,217 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace ui {
+
+// A display for either game that does nothing; every call is an empty inline
+// function, so games played with it pay nothing for the display.
+class NullDisplay {
+ public:
+  void SetVerbosity(const int) {}
+
+  template<class... Args> void OnGameStart(const Args&...) {}
+  template<class... Args> void OnBeforeMove(const Args&...) {}
+  template<class... Args> void OnAfterMove(const Args&...) {}
+  template<class... Args> void OnIllegalMove(const Args&...) {}
+  template<class... Args> void OnGameFinish(const Args&...) {}
+};
+
+// Shows games through a GameTraits::Display from a background thread. The
+// playing thread only copies the board and the latest move of each event
+// into a queue; the formatting, the writes and the flushes happen on the
+// background thread, which keeps its own copy of the game result up to date
+// from the events. Games must be played one at a time.
+template<class GameTraits>
+class AsyncDisplay {
+ public:
+  using Board = typename GameTraits::Board;
+  using Move = typename GameTraits::Move;
+  using GameResult = typename GameTraits::GameResult;
+  using Display = typename GameTraits::Display;
+
+  explicit AsyncDisplay(std::ostream& os)
+      : os_(os), display_(os), stop_(false), flush_(false), busy_(false), thread_([this] { Run(); }) {}
+
+  AsyncDisplay(const AsyncDisplay&) = delete;
+  AsyncDisplay& operator=(const AsyncDisplay&) = delete;
+
+  // Shows the events still queued before returning.
+  ~AsyncDisplay() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    cv_.notify_one();
+    thread_.join();
+  }
+
+  void SetVerbosity(const int v) {
+    Event e = Event();
+    e.kind = VERBOSITY;
+    e.verbosity = v;
+    Push(std::move(e));
+  }
+
+  void OnGameStart(const Board& board, const GameResult& result, const char* name1, const char* name2) {
+    Event e = MakeEvent(GAME_START, board, result);
+    e.names[0] = name1;
+    e.names[1] = name2;
+    Push(std::move(e));
+  }
+
+  void OnBeforeMove(const Board& board, const GameResult& result) {
+    Push(MakeEvent(BEFORE_MOVE, board, result));
+  }
+
+  void OnAfterMove(const Board& board, const GameResult& result) {
+    Push(MakeEvent(AFTER_MOVE, board, result));
+  }
+
+  void OnAfterMove(const Board& board, const GameResult& result, const Move m) {
+    Event e = MakeEvent(AFTER_MOVE, board, result);
+    e.move = m;
+    Push(std::move(e));
+  }
+
+  void OnIllegalMove(const Board& board, const GameResult& result) {
+    Push(MakeEvent(ILLEGAL_MOVE, board, result));
+  }
+
+  void OnIllegalMove(const Board& board, const GameResult& result, const Move m) {
+    Event e = MakeEvent(ILLEGAL_MOVE, board, result);
+    e.move = m;
+    Push(std::move(e));
+  }
+
+  void OnGameFinish(const Board& board, const GameResult& result) {
+    Push(MakeEvent(GAME_FINISH, board, result));
+  }
+
+  // Blocks until every queued event has been shown and the stream flushed.
+  void Flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    flush_ = true;
+    cv_.notify_one();
+    idle_cv_.wait(lock, [this] { return events_.empty() && !busy_; });
+  }
+
+ private:
+  static constexpr size_t BatchSize = 1024;
+  static constexpr int MaxDelay = 50;  // milliseconds
+
+  enum Kind { VERBOSITY, GAME_START, BEFORE_MOVE, AFTER_MOVE, ILLEGAL_MOVE, GAME_FINISH };
+  using Entry = typename GameTraits::History::value_type;
+
+  struct Event {
+    Kind kind;
+    Board board;
+    size_t history_size;
+    Entry last;          // the latest history entry, if history_size > 0
+    decltype(GameResult::winner) winner;
+    Move move;
+    const char* names[2];
+    int verbosity;
+  };
+
+  static Event MakeEvent(const Kind kind, const Board& board, const GameResult& result) {
+    Event e = Event();
+    e.kind = kind;
+    e.board = board;
+    e.history_size = result.history.size();
+    if (e.history_size) e.last = result.history.back();
+    e.winner = result.winner;
+    return e;
+  }
+
+  // Wakes the background thread only once a batch is queued; it also looks
+  // for events on its own every MaxDelay, so that a slow game is still shown
+  // as it goes.
+  void Push(Event e) {
+    bool wake;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      events_.push_back(std::move(e));
+      wake = events_.size() == BatchSize;
+    }
+    if (wake) cv_.notify_one();
+  }
+
+  // overloads for the displays that take the move as an argument and those
+  // that read it from the history
+  template<class D, class B, class R>
+  static void Call(D& d, void (D::*f)(const B&, const R&), const Event& e, const R& r) {
+    (d.*f)(e.board, r);
+  }
+
+  template<class D, class B, class R, class M>
+  static void Call(D& d, void (D::*f)(const B&, const R&, M), const Event& e, const R& r) {
+    (d.*f)(e.board, r, e.move);
+  }
+
+  void Show(const Event& e) {
+    if (e.kind == VERBOSITY) {
+      display_.SetVerbosity(e.verbosity);
+      return;
+    }
+    if (e.kind == GAME_START) result_.history.clear();
+    result_.history.resize(e.history_size);
+    if (e.history_size) result_.history.back() = e.last;
+    result_.winner = e.winner;
+    switch (e.kind) {
+      case GAME_START: display_.OnGameStart(e.board, result_, e.names[0], e.names[1]); break;
+      case BEFORE_MOVE: display_.OnBeforeMove(e.board, result_); break;
+      case AFTER_MOVE: Call(display_, &Display::OnAfterMove, e, result_); break;
+      case ILLEGAL_MOVE: Call(display_, &Display::OnIllegalMove, e, result_); break;
+      default: display_.OnGameFinish(e.board, result_); break;
+    }
+  }
+
+  void Run() {
+    std::deque<Event> events;
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+      cv_.wait_for(lock, std::chrono::milliseconds(MaxDelay), [this] { return stop_ || flush_ || events_.size() >= BatchSize; });
+      if (events_.empty()) {
+        if (stop_) return;
+        flush_ = false;  // nothing was left to flush
+        continue;
+      }
+      events.swap(events_);
+      busy_ = true;
+      lock.unlock();
+      for (const auto& e : events) Show(e);
+      events.clear();
+      os_.flush();
+      lock.lock();
+      busy_ = false;
+      if (events_.empty()) flush_ = false;
+      idle_cv_.notify_all();
+    }
+  }
+
+  std::ostream& os_;
+  Display display_;
+  GameResult result_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::condition_variable idle_cv_;
+  std::deque<Event> events_;
+  bool stop_;
+  bool flush_;
+  bool busy_;
+  std::thread thread_;
+};
+
+template<class GameTraits>
+constexpr size_t AsyncDisplay<GameTraits>::BatchSize;
+
+template<class GameTraits>
+constexpr int AsyncDisplay<GameTraits>::MaxDelay;
+
+}  // namespace ui
@@ -0,0 +1,166 @@
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "worker_pool.hpp"
+
+namespace driver {
+
+// the history entry of move m by p, for both gomoku and othello histories
+template<class P, class M>
+inline void AddMove(std::vector<M>& history, const P, const M m) { history.push_back(m); }
+
+template<class P, class M>
+inline void AddMove(std::vector<std::pair<P, M>>& history, const P p, const M m) { history.emplace_back(p, m); }
+
+// Plays many games at once without a thread per game. Each game is a small
+// state machine that is only touched when it can make progress: a game whose
+// player to move is external waits in the table, holding no thread, until
+// Play brings its move; a game whose player to move is the engine is queued
+// on the worker pool, and the worker that searches the move also applies it
+// and moves the game on. The rules are those of GameTraits::Play: an illegal
+// move loses the game.
+template<class GameTraits>
+class Driver {
+ public:
+  using Board = typename GameTraits::Board;
+  using Move = typename GameTraits::Move;
+  using Player = typename GameTraits::Player;
+  using History = typename GameTraits::History;
+  using GameResult = typename GameTraits::GameResult;
+
+  enum Side { EXTERNAL, ENGINE };
+  enum Event { WAITING, FINISHED };
+
+  // Searches a move for the player to move on the given worker; it runs on
+  // the pool, so it may keep per-worker state without locking.
+  using Engine = std::function<Move(size_t worker, const Board& board, const History& history)>;
+  // Told when a game waits for an external move and when it has finished,
+  // with the position and the result so far. It is called from whichever
+  // thread moved the game on, without any lock held, so it may call Play and
+  // Start, but should not block.
+  using Listener = std::function<void(size_t game, Event event, const Board& board, const GameResult& result)>;
+
+  Driver(util::WorkerPool& pool, Engine engine, Listener listener)
+      : pool_(pool), engine_(std::move(engine)), listener_(std::move(listener)), next_id_(0), num_unfinished_(0) {}
+
+  Driver(const Driver&) = delete;
+  Driver& operator=(const Driver&) = delete;
+
+  // Starts a game between the given sides, first player first, and returns
+  // its id. The listener may hear of the game before Start returns.
+  size_t Start(const Side first, const Side second) {
+    size_t id;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      id = next_id_++;
+      ++num_unfinished_;
+      Game& g = games_[id];
+      g.sides[0] = first;
+      g.sides[1] = second;
+      g.state = READY;
+      g.result.winner = Player();
+    }
+    Advance(id);
+    return id;
+  }
+
+  // Brings the external move of a game. Returns false if the game is not
+  // waiting for one, e.g. because it has finished.
+  bool Play(const size_t id, const Move m) {
+    return Apply(id, m, WAITING_EXTERNAL);
+  }
+
+  size_t num_active() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return games_.size();
+  }
+
+  // Blocks until every game started has finished and the listener has been
+  // told.
+  void Wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_cv_.wait(lock, [this] { return num_unfinished_ == 0; });
+  }
+
+ private:
+  enum State { READY, WAITING_EXTERNAL, SEARCHING, DONE };
+
+  struct Game {
+    Board board;
+    GameResult result;
+    Side sides[2];
+    State state;
+  };
+
+  static Player GetFirstPlayer() { return Board().current_player(); }
+
+  // Moves a READY or DONE game to its next state: tells the listener of a
+  // finished game and forgets it, waits for an external move, or queues a
+  // search.
+  void Advance(const size_t id) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    Game& g = games_.at(id);
+    if (g.state == DONE || g.board.IsFinished()) {
+      if (g.state != DONE) g.result.winner = g.board.winner();
+      const Board board = g.board;
+      const GameResult result = std::move(g.result);
+      games_.erase(id);
+      lock.unlock();
+      listener_(id, FINISHED, board, result);
+      lock.lock();
+      if (--num_unfinished_ == 0) idle_cv_.notify_all();
+      return;
+    }
+    const Board board = g.board;
+    if (g.sides[board.current_player() == GetFirstPlayer() ? 0 : 1] == EXTERNAL) {
+      g.state = WAITING_EXTERNAL;
+      const GameResult result = g.result;
+      lock.unlock();
+      listener_(id, WAITING, board, result);
+      return;
+    }
+    g.state = SEARCHING;
+    const History history = g.result.history;
+    lock.unlock();
+    pool_.Submit([this, id, board, history] (const size_t worker) {
+      Apply(id, engine_(worker, board, history), SEARCHING);
+    });
+  }
+
+  // Plays m in a game in the expected state and moves the game on.
+  bool Apply(const size_t id, const Move m, const State expected) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      const auto it = games_.find(id);
+      if (it == games_.end() || it->second.state != expected) return false;
+      Game& g = it->second;
+      const Player p = g.board.current_player();
+      AddMove(g.result.history, p, m);
+      if (g.board.IsLegalMove(m)) {
+        g.board.Next(m);
+        g.state = READY;
+      } else {
+        g.result.winner = GameTraits::GetOppositePlayer(p);
+        g.state = DONE;
+      }
+    }
+    Advance(id);
+    return true;
+  }
+
+  util::WorkerPool& pool_;
+  Engine engine_;
+  Listener listener_;
+  mutable std::mutex mutex_;
+  std::condition_variable idle_cv_;
+  std::unordered_map<size_t, Game> games_;
+  size_t next_id_;
+  size_t num_unfinished_;  // games started whose listener has not returned from FINISHED
+};
+
+}  // namespace driver
@@ -66,6 +66,45 @@ class Board {
     return !IsFinished() && m >= 0 && m < N * N && array_[m] == NONE;
   }
 
+  // Whether the next move may end the game: one cell is left, or some K
+  // cells in a line hold K - 1 stones of the player to move and one empty
+  // cell. Such a line begins with one of those stones, or with the empty
+  // cell followed by K - 1 of them.
+  bool MayEndNext() const {
+    if (number_of_moves_ == N * N - 1) return true;
+    if (number_of_moves_ / 2 < K - 1) return false;
+    const Player p = current_player_;
+    bool found = false;
+    ForEachStone([this, p, &found] (const Move m, const CellValue v) {
+      if (found || v != p) return;
+      for (int d = 0; d < 4 && !found; ++d) {
+        const auto& line = lines_[m][d][1];
+        int stones = 1;
+        int empties = 0;
+        for (int k = 0; k < K - 1 && line[k] >= 0; ++k) {
+          const CellValue r = array_[line[k]];
+          if (r == p) {
+            ++stones;
+          } else if (r == NONE && !empties) {
+            ++empties;
+          } else {
+            break;
+          }
+        }
+        const auto before = lines_[m][d][0][0];
+        found = stones == K - 1 && (empties || (before >= 0 && array_[before] == NONE));
+      }
+    });
+    return found;
+  }
+
+  // What Undo needs to take back a move.
+  struct UndoInfo {
+    Move move;
+    Player player;
+    Player winner;
+  };
+
   void Next(const int i, const int j) { Next(GetMove(i, j)); }
 
   void Next(const Move m) {
@@ -76,6 +115,21 @@ class Board {
     CheckWinner(m);
   }
 
+  void Next(const Move m, UndoInfo& undo) {
+    undo.move = m;
+    undo.player = current_player_;
+    undo.winner = winner_;
+    Next(m);
+  }
+
+  // Takes back the move that undo was filled by, which must be the last one.
+  void Undo(const UndoInfo& undo) {
+    array_[undo.move] = NONE;
+    --number_of_moves_;
+    current_player_ = undo.player;
+    winner_ = undo.winner;
+  }
+
   std::vector<Move> GetLegalMoves() const {
     std::vector<Move> moves;
     for (Move m = 0; m < N * N; ++m) {
@@ -84,6 +138,46 @@ class Board {
     return moves;
   }
 
+  // A static estimate of the position for the player to move in [-1, 1].
+  // Every line of K cells that holds stones of only one player counts
+  // 4^stones for that player, so open threats weigh the most.
+  double Evaluate() const {
+    const Player p = current_player_;
+    double sum = 0;
+    for (Move m = 0; m < N * N; ++m) {
+      for (int d = 0; d < 4; ++d) {
+        const auto& line = lines_[m][d][1];
+        if (line[K - 2] < 0) continue;  // runs off the board
+        int own = array_[m] == p;
+        int other = array_[m] != NONE && !own;
+        for (int k = 0; k < K - 1; ++k) {
+          const CellValue v = array_[line[k]];
+          own += v == p;
+          other += v != NONE && v != p;
+        }
+        if (own && !other) sum += 1 << (2 * own);
+        if (other && !own) sum -= 1 << (2 * other);
+      }
+    }
+    return std::tanh(sum / (1 << (2 * K - 2)));
+  }
+
+  // Calls f(m, v) for every stone. Empty bytes of the packed array are skipped
+  // four cells at a time, which makes this cheap on sparse boards.
+  template<class F>
+  void ForEachStone(F f) const {
+    const auto& bytes = array_.bytes();
+    for (size_t j = 0; j < bytes.size(); ++j) {
+      unsigned b = bytes[j];
+      while (b) {
+        const int k = (__builtin_clz(b) - 24) / 2;  // first non-empty cell in the byte
+        const int s = 6 - 2 * k;
+        f(static_cast<Move>(j * 4 + k), static_cast<CellValue>((b >> s) & 0b11));
+        b &= ~(0b11u << s);
+      }
+    }
+  }
+
  private:
   void CheckWinner(const Move m) {
     const CellValue v = array_[m];
@@ -142,7 +236,7 @@ std::ostream& operator<<(std::ostream& os, const Board<N>& board) {
     for (BoardSize j = 0; j < N; ++j) {
       os << ToSymbol(a[i * N + j]);
     }
-    os << std::endl;
+    os << '\n';
   }
   return os;
 }
@@ -184,20 +278,51 @@ void Play(Board<N>& board,
   display.OnGameFinish(board, result);
 }
 
+namespace ui {
+template<BoardSize N> class BasicDisplay;
+}  // namespace ui
+
 template<BoardSize N>
 struct GameTraits {
   using Board = gomoku::Board<N>;
   using Move = gomoku::Move;
   using Player = gomoku::Player;
   using History = gomoku::History;
+  using GameResult = gomoku::GameResult<N>;
+  using Display = ui::BasicDisplay<N>;
 
   static constexpr auto MaxPos = N;
 
+  static const char* GetGameName() { return "gomoku"; }
+
   static void PrintMove(std::ostream& os, const Move m) {
     gomoku::PrintMove(os, m, N);
   }
 
   static Move GetIllegalMove() { return IllegalMove; }
+
+  static Player GetOppositePlayer(const Player p) { return gomoku::GetOppositePlayer(p); }
+
+  // Final score of a finished game for p in [-1, 1]; there is no margin in
+  // gomoku, only the outcome.
+  static double GetScore(const Board& board, const Player p) {
+    return board.IsDraw() ? 0 : board.winner() == p ? 1 : -1;
+  }
+
+  // A static estimate of an unfinished position for the player to move, on
+  // the scale of GetScore.
+  static double Evaluate(const Board& board) { return board.Evaluate(); }
+
+  template<class Black, class White, class D>
+  static void Play(Board& board, Black& p1, White& p2, GameResult& result, D& display) {
+    gomoku::Play(board, p1, p2, result, display);
+  }
+
+  // Calls f(m, s) for every stone, where s is 0 for black and 1 for white.
+  template<class F>
+  static void ForEachStone(const Board& board, F f) {
+    board.ForEachStone([&f] (const Move m, const CellValue v) { f(m, v == BLACK ? 0 : 1); });
+  }
 };
 
 namespace ui {
@@ -213,51 +338,52 @@ class BasicDisplay {
                    const GameResult<N>& result,
                    const char* black_name,
                    const char* white_name) {
-    os_ << "A new game has started." << std::endl;
-    os_ << "Player 1 (Black): " << black_name << std::endl;
-    os_ << "Player 2 (White): " << white_name << std::endl;
+    os_ << "A new game has started.\n";
+    os_ << "Player 1 (Black): " << black_name << '\n';
+    os_ << "Player 2 (White): " << white_name << '\n';
   }
 
   void OnBeforeMove(const Board<N>& board, const GameResult<N>& result) {
     if (verbosity_ < 2) return;
-    os_ << std::endl
-        << "Turn #" << result.history.size() + 1 << std::endl
-        << ToPlayerString(board.current_player()) << "'s move" << std::endl
-        << "Board before move:" << std::endl
-        << board << std::endl;
+    os_ << '\n'
+        << "Turn #" << result.history.size() + 1 << '\n'
+        << ToPlayerString(board.current_player()) << "'s move\n"
+        << "Board before move:\n"
+        << board << '\n';
   }
 
   void OnAfterMove(const Board<N>& board, const GameResult<N>& result, const Move m) {
     if (verbosity_ < 1) return;
     os_ << "Move: ";
     PrintMove(os_, m, N);
-    os_ << std::endl;
+    os_ << '\n';
   }
 
   void OnIllegalMove(const Board<N>& board, const GameResult<N>& result, const Move m) {
     os_ << "Illegal move: ";
     PrintMove(os_, m, N);
-    os_ << std::endl;
+    os_ << '\n';
   }
 
   void OnGameFinish(const Board<N>& board, const GameResult<N>& result) {
     os_ << "The game has finished after "
-        << result.history.size() << " moves." << std::endl
-        << board << std::endl;
+        << result.history.size() << " moves.\n"
+        << board << '\n';
     if (result.winner == NONE) {
-      os_ << "The game was a draw." << std::endl;
+      os_ << "The game was a draw.\n";
     } else {
-      os_ << ToPlayerString(result.winner) << " has won the game." << std::endl;
+      os_ << ToPlayerString(result.winner) << " has won the game.\n";
     }
     if (verbosity_ >= 3) {
-      os_ << "Moves:" << std::endl;
+      os_ << "Moves:\n";
       size_t i = 1;
       for (const auto m : result.history) {
         os_ << "#" << i++ << ": ";
         PrintMove(os_, m, N);
-        os_ << std::endl;
+        os_ << '\n';
       }
     }
+    os_.flush();
   }
 
  private:
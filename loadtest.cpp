@@ -0,0 +1,197 @@
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "dispatch.hpp"
+#include "driver.hpp"
+#include "player.hpp"
+#include "worker_pool.hpp"
+
+// Plays many games at once through driver::Driver between simulated clients
+// and MCTS engines, and reports how long the clients waited for the engine.
+// Each client answers after a random thinking time with a random legal move;
+// all clients share one thread, and the engines run on --threads workers, so
+// thousands of games in play need no more than a handful of threads.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+  std::string game = "othello";
+  int size = 8;
+  size_t games = 10000;       // games played in total
+  size_t concurrent = 2000;   // games in play at once
+  size_t threads = std::thread::hardware_concurrency();
+  size_t iterations = 50;     // per engine move
+  int think = 20;             // milliseconds; clients think up to this long
+  size_t seed = 1;
+};
+
+bool ParseOption(Options& opt, const char* arg) {
+  const char* eq = std::strchr(arg, '=');
+  if (std::strncmp(arg, "--", 2) != 0 || !eq) return false;
+  const std::string key(arg + 2, eq);
+  const char* value = eq + 1;
+  if (key == "game") return dispatch::ParseGame(value, opt.game, opt.size);
+  else if (key == "games") opt.games = std::strtoul(value, nullptr, 10);
+  else if (key == "concurrent") opt.concurrent = std::strtoul(value, nullptr, 10);
+  else if (key == "threads") opt.threads = std::strtoul(value, nullptr, 10);
+  else if (key == "iterations") opt.iterations = std::strtoul(value, nullptr, 10);
+  else if (key == "think") opt.think = std::atoi(value);
+  else if (key == "seed") opt.seed = std::strtoul(value, nullptr, 10);
+  else return false;
+  return true;
+}
+
+double GetMilliseconds(const Clock::duration d) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(d).count() / 1000.0;
+}
+
+struct LoadTest {
+  const Options& opt;
+
+  template<class GT>
+  void Run() {
+    using Board = typename GT::Board;
+    using Driver = driver::Driver<GT>;
+
+    // the engines of each worker
+    util::WorkerPool pool(opt.threads);
+    std::vector<std::unique_ptr<std::mt19937>> rngs;
+    std::vector<std::unique_ptr<player::GenericMCTS<GT>>> engines;
+    for (size_t i = 0; i < pool.size(); ++i) {
+      rngs.emplace_back(new std::mt19937(opt.seed + i));
+      engines.emplace_back(new player::GenericMCTS<GT>(*rngs.back(), std::chrono::milliseconds(0)));
+      engines.back()->SetMaxIterations(util::at_least_1(opt.iterations));
+    }
+
+    // the clients: moves due at some time, the time each move was sent, and
+    // the games still to start
+    struct Pending {
+      Clock::time_point due;
+      size_t game;
+      Board board;
+      bool operator>(const Pending& p) const { return due > p.due; }
+    };
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::priority_queue<Pending, std::vector<Pending>, std::greater<Pending>> pending;
+    std::unordered_map<size_t, Clock::time_point> sent;
+    std::vector<double> latencies;  // milliseconds from a client move to the engine's answer
+    std::mt19937 rng(opt.seed);
+    std::uniform_int_distribution<> think(0, std::max(opt.think, 0));
+    size_t num_finished = 0;
+    size_t num_moves = 0;
+    size_t to_start = std::min(opt.concurrent, opt.games);
+
+    Driver d(pool, [&engines] (const size_t worker, const Board& board, const typename GT::History& history) {
+      return engines[worker]->GetNextMove(board, history);
+    }, [&] (const size_t game, const typename Driver::Event event, const Board& board,
+            const typename GT::GameResult& result) {
+      const auto now = Clock::now();
+      std::lock_guard<std::mutex> lock(mutex);
+      const auto it = sent.find(game);
+      if (it != sent.end()) {
+        latencies.push_back(GetMilliseconds(now - it->second));
+        sent.erase(it);
+      }
+      if (event == Driver::FINISHED) {
+        ++num_finished;
+        num_moves += result.history.size();
+        ++to_start;
+      } else {
+        pending.push(Pending{now + std::chrono::milliseconds(think(rng)), game, board});
+      }
+      cv.notify_one();
+    });
+
+    const auto start_time = Clock::now();
+    size_t num_started = 0;
+    size_t max_active = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (num_finished < opt.games) {
+      if (to_start && num_started < opt.games) {
+        --to_start;
+        // the clients move first in every other game
+        const bool client_first = num_started++ % 2 == 0;
+        lock.unlock();
+        d.Start(client_first ? Driver::EXTERNAL : Driver::ENGINE, client_first ? Driver::ENGINE : Driver::EXTERNAL);
+        max_active = std::max(max_active, d.num_active());
+        lock.lock();
+        continue;
+      }
+      if (!pending.empty() && pending.top().due <= Clock::now()) {
+        const Pending p = pending.top();
+        pending.pop();
+        const auto moves = p.board.GetLegalMoves();
+        const auto m = moves[std::uniform_int_distribution<size_t>(0, moves.size() - 1)(rng)];
+        sent[p.game] = Clock::now();
+        lock.unlock();
+        d.Play(p.game, m);
+        lock.lock();
+        continue;
+      }
+      if (pending.empty()) {
+        cv.wait(lock);
+      } else {
+        cv.wait_until(lock, pending.top().due);
+      }
+    }
+    lock.unlock();
+    d.Wait();
+    pool.Wait();
+    const double seconds = GetMilliseconds(Clock::now() - start_time) / 1000;
+
+    std::sort(latencies.begin(), latencies.end());
+    double mean = 0;
+    for (const auto l : latencies) mean += l;
+    mean /= std::max<size_t>(latencies.size(), 1);
+    const auto percentile = [&latencies] (const double q) {
+      return latencies.empty() ? 0 : latencies[std::min(latencies.size() - 1, static_cast<size_t>(q * latencies.size()))];
+    };
+    std::cout << "Game = " << GT::GetGameName() << " " << static_cast<int>(GT::MaxPos) << "x"
+              << static_cast<int>(GT::MaxPos) << std::endl
+              << "Games = " << num_finished << " (" << max_active << " in play at most)" << std::endl
+              << "Threads = " << pool.size() << " engine workers + 1 client" << std::endl
+              << "Moves = " << num_moves << std::endl
+              << "Time = " << seconds << " sec" << std::endl
+              << "Throughput = " << num_finished / seconds << " games/s, " << num_moves / seconds << " moves/s"
+              << std::endl
+              << "Engine latency = " << mean << " ms mean, " << percentile(.5) << " ms median, "
+              << percentile(.99) << " ms p99" << std::endl;
+  }
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options opt;
+  for (int i = 1; i < argc; ++i) {
+    if (!ParseOption(opt, argv[i])) {
+      std::cerr << "usage: " << argv[0]
+                << " [--game=gomoku|othello[:SIZE]] [--games=N] [--concurrent=N] [--threads=N]"
+                << " [--iterations=N] [--think=MS] [--seed=N]" << std::endl;
+      return 1;
+    }
+  }
+  opt.threads = util::at_least_1(opt.threads);
+  LoadTest test{opt};
+  if (!dispatch::Run(opt.game, opt.size, test)) {
+    std::cerr << "Unsupported " << opt.game << " board size " << opt.size
+              << "; supported sizes are " << dispatch::GetSupportedSizes(opt.game) << std::endl;
+    return 1;
+  }
+  return 0;
+}
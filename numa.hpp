@@ -0,0 +1,110 @@
+#pragma once
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#include "util.hpp"
+
+namespace util {
+
+// The NUMA nodes of the machine and their cpus, as far as this process may
+// run on them. Where /sys/devices/system/node is missing, the machine is one
+// node with every cpu the process may use.
+class Topology {
+ public:
+  struct Node {
+    int id;
+    std::vector<int> cpus;
+  };
+
+  static Topology Read() {
+    Topology t;
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    const bool has_affinity = ::sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+    auto is_allowed = [&allowed, has_affinity] (const int cpu) {
+      return !has_affinity || (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed));
+    };
+    const char* root = "/sys/devices/system/node";
+    if (DIR* dir = ::opendir(root)) {
+      while (const dirent* e = ::readdir(dir)) {
+        if (std::string(e->d_name).compare(0, 4, "node") != 0 || !std::isdigit(e->d_name[4])) continue;
+        Node node{std::atoi(e->d_name + 4), {}};
+        std::ifstream in(std::string(root) + "/" + e->d_name + "/cpulist");
+        std::string list;
+        in >> list;
+        for (const int cpu : ParseCpuList(list)) {
+          if (is_allowed(cpu)) node.cpus.push_back(cpu);
+        }
+        if (!node.cpus.empty() && node.id < 64) t.nodes_.push_back(node);
+      }
+      ::closedir(dir);
+    }
+    std::sort(t.nodes_.begin(), t.nodes_.end(), [] (const Node& a, const Node& b) { return a.id < b.id; });
+    if (t.nodes_.empty()) {
+      Node node{0, {}};
+      const int n = has_affinity ? CPU_SETSIZE : util::at_least_1<int>(std::thread::hardware_concurrency());
+      for (int cpu = 0; cpu < n; ++cpu) {
+        if (is_allowed(cpu)) node.cpus.push_back(cpu);
+      }
+      if (node.cpus.empty()) node.cpus.push_back(0);
+      t.nodes_.push_back(node);
+    }
+    return t;
+  }
+
+  const std::vector<Node>& nodes() const { return nodes_; }
+  size_t num_nodes() const { return nodes_.size(); }
+
+  // every node id, a bit per node, as taken by util::Arena::SetInterleave
+  uint64_t node_mask() const {
+    uint64_t mask = 0;
+    for (const auto& node : nodes_) mask |= uint64_t{1} << node.id;
+    return mask;
+  }
+
+  // Workers are dealt to the nodes in turn and to the cpus of their node in
+  // turn, so that a few workers still use every node's memory bandwidth.
+  size_t GetNodeIndex(const size_t worker) const { return worker % nodes_.size(); }
+
+  int GetCpu(const size_t worker) const {
+    const auto& cpus = nodes_[GetNodeIndex(worker)].cpus;
+    return cpus[worker / nodes_.size() % cpus.size()];
+  }
+
+  // "0-3,8,10-11" -> {0, 1, 2, 3, 8, 10, 11}
+  static std::vector<int> ParseCpuList(const std::string& list) {
+    std::vector<int> cpus;
+    const char* p = list.c_str();
+    while (std::isdigit(*p)) {
+      char* end;
+      const int first = std::strtol(p, &end, 10);
+      int last = first;
+      if (*end == '-') last = std::strtol(end + 1, &end, 10);
+      for (int cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+      p = *end == ',' ? end + 1 : end;
+    }
+    return cpus;
+  }
+
+ private:
+  std::vector<Node> nodes_;
+};
+
+// Runs the calling thread on the given cpu only. Returns false if that is
+// not allowed, leaving the thread where it was.
+inline bool PinThread(const int cpu) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  return ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set) == 0;
+}
+
+}  // namespace util
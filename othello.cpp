@@ -1,9 +1,14 @@
 #include <chrono>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <random>
 #include <vector>
+#include "dispatch.hpp"
+#include "display.hpp"
 #include "othello.hpp"
+#include "params.hpp"
 #include "player.hpp"
 
 struct Result {
@@ -22,48 +27,107 @@ std::ostream& operator<<(std::ostream& os, const Result& r) {
             << r.light_wins;
 }
 
-int main() {
-  constexpr const uint8_t N = 8;
-  using GT = othello::GameTraits<N>;
-  std::random_device rd;
-  std::ofstream out("/dev/null");
-  othello::ui::BasicDisplay<N> display(out);
-  display.SetVerbosity(0);
-  std::vector<Result> results;
-  std::vector<int> times = {100, 200, 400, 1000, 2000, 3000};
-  const auto rep = 10;
-  for (const auto time1 : times) {
-    for (const auto time2 : times) {
-      Result r{time1, time2, 0, 0, 0};
-      for (auto i = 0; i < rep; ++i) {
-        const size_t seed1 = rd();
-        std::cout << "Seed 1 = " << seed1 << std::endl;
-        std::mt19937 rng1(seed1);
-        player::GenericMCTS<GT> mcts1(rng1, time1);
-        mcts1.SetBias(.4);
-        const size_t seed2 = rd();
-        std::cout << "Seed 2 = " << seed2 << std::endl;
-        std::mt19937 rng2(seed2);
-        player::GenericMCTS<GT> mcts2(rng2, time2);
-        mcts2.SetBias(.4);
-        othello::Board<N> b;
-        othello::GameResult<N> result;
-        othello::Play(b, mcts1, mcts2, result, display);
-        if (result.winner == othello::DARK) {
-          ++r.dark_wins;
-        } else if (result.winner == othello::LIGHT) {
-          ++r.light_wins;
-        } else {
-          ++r.ties;
+struct Match {
+  const char* log;   // file the games are written to, if any
+  const char* root;  // root policy of the first player: ucb, halving or gumbel
+  const player::ParamTable* table;  // tuned search constants, if any
+
+  template<class GT>
+  void Run() {
+    if (!log) {
+      ui::NullDisplay display;
+      Run<GT>(display);
+      return;
+    }
+    std::ofstream out(log);
+    ui::AsyncDisplay<GT> display(out);
+    display.SetVerbosity(1);
+    Run<GT>(display);
+  }
+
+  // the tuned constants for the nearest thinking time, if the table has them
+  template<class GT>
+  void SetParams(player::GenericMCTS<GT>& mcts, const int time) {
+    player::SearchParams params;
+    if (table && table->Find("othello", GT::MaxPos, true, time, params)) player::ApplyParams(params, mcts);
+  }
+
+  template<class GT, class Display>
+  void Run(Display& display) {
+    std::random_device rd;
+    std::vector<Result> results;
+    std::vector<int> times = {100, 200, 400, 1000, 2000, 3000};
+    const auto rep = 10;
+    for (const auto time1 : times) {
+      for (const auto time2 : times) {
+        Result r{time1, time2, 0, 0, 0};
+        for (auto i = 0; i < rep; ++i) {
+          const size_t seed1 = rd();
+          std::cout << "Seed 1 = " << seed1 << std::endl;
+          std::mt19937 rng1(seed1);
+          player::GenericMCTS<GT> mcts1(rng1, std::chrono::milliseconds(time1));
+          mcts1.SetBias(.4);
+          using MCTS = player::GenericMCTS<GT>;
+          SetParams(mcts1, time1);
+          mcts1.SetRootPolicy(std::strcmp(root, "halving") == 0 ? MCTS::SEQUENTIAL_HALVING
+                              : std::strcmp(root, "gumbel") == 0 ? MCTS::GUMBEL : MCTS::UCB);
+          const size_t seed2 = rd();
+          std::cout << "Seed 2 = " << seed2 << std::endl;
+          std::mt19937 rng2(seed2);
+          player::GenericMCTS<GT> mcts2(rng2, std::chrono::milliseconds(time2));
+          mcts2.SetBias(.4);
+          SetParams(mcts2, time2);
+          typename GT::Board b;
+          typename GT::GameResult result;
+          GT::Play(b, mcts1, mcts2, result, display);
+          if (result.winner == othello::DARK) {
+            ++r.dark_wins;
+          } else if (result.winner == othello::LIGHT) {
+            ++r.light_wins;
+          } else {
+            ++r.ties;
+          }
+          std::cout << r << std::endl;
+        }
+        std::cout << "===" << std::endl;
+        results.push_back(r);
+        for (const auto r : results) {
+          std::cout << r << std::endl;
         }
-        std::cout << r << std::endl;
       }
-      std::cout << "===" << std::endl;
-      results.push_back(r);
-      for (const auto r : results) {
-        std::cout << r << std::endl;
+    }
+  }
+};
+
+int main(int argc, char** argv) {
+  int size = dispatch::GetDefaultSize("othello");
+  player::ParamTable table;
+  Match match{nullptr, "ucb", nullptr};
+  for (int i = 1; i < argc; ++i) {
+    if (std::sscanf(argv[i], "--size=%d", &size) == 1) continue;
+    if (std::strncmp(argv[i], "--log=", 6) == 0) {
+      match.log = argv[i] + 6;
+      continue;
+    }
+    if (std::strncmp(argv[i], "--params=", 9) == 0) {
+      if (!table.Load(argv[i] + 9)) {
+        std::cerr << "Cannot read the parameter table " << argv[i] + 9 << std::endl;
+        return 1;
       }
+      match.table = &table;
+      continue;
+    }
+    if (std::strncmp(argv[i], "--root=", 7) == 0) {
+      match.root = argv[i] + 7;
+      continue;
     }
+    std::cerr << "usage: " << argv[0] << " [--size=N] [--log=FILE] [--root=ucb|halving|gumbel] [--params=FILE]" << std::endl;
+    return 1;
+  }
+  if (!dispatch::Run("othello", size, match)) {
+    std::cerr << "Unsupported board size " << size << "; supported sizes are "
+              << dispatch::GetSupportedSizes("othello") << std::endl;
+    return 1;
   }
   return 0;
 }
@@ -92,10 +92,28 @@ class Board {
     return !IsFinished() && m >= 0 && m < N * N && CanBePlaced(array_[m], current_player_);
   }
 
+  // Whether the next move may end the game: at most N cells are left empty,
+  // or the opponent has at most N discs, few enough to be flipped at once.
+  // The rare other endings, with neither player able to move, are left to
+  // be found once the board after the move is built.
+  bool MayEndNext() const {
+    const Move n_q = current_player_ == DARK ? num_lights_ : num_darks_;
+    return N * N - num_darks_ - num_lights_ <= N || n_q <= N;
+  }
+
   int8_t GetDifference(const Player p) const {
     return p == DARK ? num_darks_ - num_lights_ : num_lights_ - num_darks_;
   }
 
+  // What Undo needs to take back a move: the cells as they were, placeable
+  // marks included, which are cheaper to copy back than to recompute.
+  struct UndoInfo {
+    Array array;
+    Player player;
+    Move num_darks;
+    Move num_lights;
+  };
+
   void Next(const int i, const int j) { Next(GetMove(i, j)); }
 
   void Next(const Move m) {
@@ -143,6 +161,68 @@ class Board {
         }
       }
     }
+    UpdatePlaceable(p);
+  }
+
+  void Next(const Move m, UndoInfo& undo) {
+    undo.array = array_;
+    undo.player = current_player_;
+    undo.num_darks = num_darks_;
+    undo.num_lights = num_lights_;
+    Next(m);
+  }
+
+  // Takes back the move that undo was filled by, which must be the last one.
+  void Undo(const UndoInfo& undo) {
+    array_ = undo.array;
+    current_player_ = undo.player;
+    winner_ = NONE;
+    num_darks_ = undo.num_darks;
+    num_lights_ = undo.num_lights;
+  }
+
+  std::vector<Move> GetLegalMoves() const {
+    std::vector<Move> moves;
+    for (Move m = 0; m < N * N; ++m) {
+      if (CanBePlaced(array_[m], current_player_)) moves.emplace_back(m);
+    }
+    return moves;
+  }
+
+  // A static estimate of the position for the player to move in [-1, 1],
+  // from the corners taken and the mobility of both players.
+  double Evaluate() const {
+    const Player p = current_player_;
+    const Player q = GetOppositePlayer(p);
+    int mobility = 0;
+    for (Move m = 0; m < N * N; ++m) {
+      const CellValue v = array_[m];
+      mobility += CanBePlaced(v, p) - CanBePlaced(v, q);
+    }
+    int corners = 0;
+    for (const Move m : {0, N - 1, N * (N - 1), N * N - 1}) {
+      corners += (array_[m] == p) - (array_[m] == q);
+    }
+    return std::max(-1.0, std::min(1.0, (8.0 * corners + mobility) / (N * N)));
+  }
+
+  // Calls f(m, v) for every disc.
+  template<class F>
+  void ForEachStone(F f) const {
+    for (Move m = 0; m < N * N; ++m) {
+      const CellValue v = array_[m];
+      if (!IsEmpty(v)) f(m, v);
+    }
+  }
+
+ private:
+  using Lines = util::Lines<int8_t, N, N - 1>;
+
+  // Marks the empty cells where each player may place, then gives the turn
+  // to the opponent of p, who just moved, or back to p if the opponent
+  // cannot move, or ends the game.
+  void UpdatePlaceable(const Player p) {
+    const auto q = GetOppositePlayer(p);
     bool p_has_legal_moves = false;
     bool q_has_legal_moves = false;
     for (Move mm = 0; mm < N * N; ++mm) {
@@ -198,17 +278,6 @@ class Board {
     }
   }
 
-  std::vector<Move> GetLegalMoves() const {
-    std::vector<Move> moves;
-    for (Move m = 0; m < N * N; ++m) {
-      if (CanBePlaced(array_[m], current_player_)) moves.emplace_back(m);
-    }
-    return moves;
-  }
-
- private:
-  using Lines = util::Lines<int8_t, N, N - 1>;
-
   void StartingPosition() {
     const auto k = N / 2;
     array_[GetMove(k, k + 1)] = DARK;
@@ -245,10 +314,10 @@ std::ostream& operator<<(std::ostream& os, const Board<N>& board) {
     for (BoardSize j = 0; j < N; ++j) {
       os << ToSymbol(a[i * N + j]);
     }
-    os << std::endl;
+    os << '\n';
   }
-  os << "Dark: " << static_cast<int>(board.num_darks()) << std::endl;
-  os << "Light: " << static_cast<int>(board.num_lights()) << std::endl;
+  os << "Dark: " << static_cast<int>(board.num_darks()) << '\n';
+  os << "Light: " << static_cast<int>(board.num_lights()) << '\n';
   return os;
 }
 
@@ -289,20 +358,51 @@ void Play(Board<N>& board,
   display.OnGameFinish(board, result);
 }
 
+namespace ui {
+template<BoardSize N> class BasicDisplay;
+}  // namespace ui
+
 template<BoardSize N>
 struct GameTraits {
   using Board = othello::Board<N>;
   using Move = othello::Move;
   using Player = othello::Player;
   using History = othello::History;
+  using GameResult = othello::GameResult<N>;
+  using Display = ui::BasicDisplay<N>;
 
   static constexpr auto MaxPos = N;
 
+  static const char* GetGameName() { return "othello"; }
+
   static void PrintMove(std::ostream& os, const Move m) {
     othello::PrintMove(os, m, N);
   }
 
   static Move GetIllegalMove() { return IllegalMove; }
+
+  static Player GetOppositePlayer(const Player p) { return othello::GetOppositePlayer(p); }
+
+  // Final score of a finished game for p in [-1, 1], the disc difference
+  // over the number of cells; the opponent's score is its negation.
+  static double GetScore(const Board& board, const Player p) {
+    return static_cast<double>(board.GetDifference(p)) / (N * N);
+  }
+
+  // A static estimate of an unfinished position for the player to move, on
+  // the scale of GetScore.
+  static double Evaluate(const Board& board) { return board.Evaluate(); }
+
+  template<class Dark, class Light, class D>
+  static void Play(Board& board, Dark& p1, Light& p2, GameResult& result, D& display) {
+    othello::Play(board, p1, p2, result, display);
+  }
+
+  // Calls f(m, s) for every disc, where s is 0 for dark and 1 for light.
+  template<class F>
+  static void ForEachStone(const Board& board, F f) {
+    board.ForEachStone([&f] (const Move m, const CellValue v) { f(m, v == DARK ? 0 : 1); });
+  }
 };
 
 namespace player {
@@ -315,10 +415,12 @@ class Greedy {
   Move GetNextMove(const Board<N>& board, const History& history) {
     Move best_move = IllegalMove;
     int8_t best_difference = -N * N;
+    Board<N> b = board;
+    typename Board<N>::UndoInfo undo;
     for (const auto m : board.GetLegalMoves()) {
-      Board<N> b = board;
-      b.Next(m);
+      b.Next(m, undo);
       const auto d = b.GetDifference(board.current_player());
+      b.Undo(undo);
       if (d > best_difference) {
         best_move = m;
         best_difference = d;
@@ -343,51 +445,52 @@ class BasicDisplay {
                    const GameResult<N>& result,
                    const char* black_name,
                    const char* white_name) {
-    os_ << "A new game has started." << std::endl;
-    os_ << "Player 1 (Dark): " << black_name << std::endl;
-    os_ << "Player 2 (Light): " << white_name << std::endl;
+    os_ << "A new game has started.\n";
+    os_ << "Player 1 (Dark): " << black_name << '\n';
+    os_ << "Player 2 (Light): " << white_name << '\n';
   }
 
   void OnBeforeMove(const Board<N>& board, const GameResult<N>& result) {
     if (verbosity_ < 2) return;
-    os_ << std::endl
-        << "Turn #" << result.history.size() + 1 << std::endl
-        << ToPlayerString(board.current_player()) << "'s move" << std::endl
-        << "Board before move:" << std::endl
-        << board << std::endl;
+    os_ << '\n'
+        << "Turn #" << result.history.size() + 1 << '\n'
+        << ToPlayerString(board.current_player()) << "'s move\n"
+        << "Board before move:\n"
+        << board << '\n';
   }
 
   void OnAfterMove(const Board<N>& board, const GameResult<N>& result) {
     if (verbosity_ < 1) return;
     os_ << ToPlayerString(result.history.back().first) << " at ";
     PrintMove(os_, result.history.back().second, N);
-    os_ << std::endl;
+    os_ << '\n';
   }
 
   void OnIllegalMove(const Board<N>& board, const GameResult<N>& result) {
     os_ << "Illegal move: ";
     PrintMove(os_, result.history.back().second, N);
-    os_ << std::endl;
+    os_ << '\n';
   }
 
   void OnGameFinish(const Board<N>& board, const GameResult<N>& result) {
     os_ << "The game has finished after " << result.history.size()
-        << " moves." << std::endl
-        << board << std::endl;
+        << " moves.\n"
+        << board << '\n';
     if (result.winner == NONE) {
-      os_ << "The game was a tie." << std::endl;
+      os_ << "The game was a tie.\n";
     } else {
-      os_ << ToPlayerString(result.winner) << " has won the game." << std::endl;
+      os_ << ToPlayerString(result.winner) << " has won the game.\n";
     }
     if (verbosity_ >= 3) {
-      os_ << "Moves:" << std::endl;
+      os_ << "Moves:\n";
       size_t i = 1;
-      for (const auto p : result.history) {
+      for (const auto& p : result.history) {
         os_ << "#" << i++ << ": " << ToPlayerString(p.first) << " at ";
         PrintMove(os_, p.second, N);
-        os_ << std::endl;
+        os_ << '\n';
       }
     }
+    os_.flush();
   }
 
  private:
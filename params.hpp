@@ -0,0 +1,126 @@
+#pragma once
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace player {
+
+// the largest budgets ParseBudget accepts, so that a search ends in
+// reasonable time
+constexpr size_t MaxThinkingTime = 60000;  // milliseconds
+constexpr size_t MaxIterations = 10000000;
+
+// The search constants of GenericMCTS that are worth tuning.
+struct SearchParams {
+  double bias;           // SetBias
+  double margin_weight;  // SetMarginWeight
+};
+
+template<class MCTS>
+void ApplyParams(const SearchParams& p, MCTS& mcts) {
+  mcts.SetBias(p.bias);
+  mcts.SetMarginWeight(p.margin_weight);
+}
+
+// Tuned search constants by game, board size and budget, kept in a text file
+// of one entry per line:
+//
+//   # game size budget bias margin
+//   othello 8 1000it 0.42 0.05
+//   othello 8 100ms 0.38 0
+//
+// where the budget is an iteration count or a thinking time, as in requests
+// to the server. Lines starting with # are comments.
+class ParamTable {
+ public:
+  struct Entry {
+    std::string game;
+    int size;
+    bool by_time;
+    size_t budget;
+    SearchParams params;
+  };
+
+  // Returns false if the file cannot be read or has a malformed line.
+  bool Load(const char* path) {
+    std::ifstream in(path);
+    if (!in) return false;
+    entries_.clear();
+    std::string line;
+    while (std::getline(in, line)) {
+      const auto first = line.find_first_not_of(" \t\r");
+      if (first == std::string::npos || line[first] == '#') continue;
+      std::istringstream ls(line);
+      Entry e;
+      std::string budget;
+      if (!(ls >> e.game >> e.size >> budget >> e.params.bias >> e.params.margin_weight) ||
+          !ParseBudget(budget, e.by_time, e.budget)) {
+        return false;
+      }
+      entries_.push_back(e);
+    }
+    return true;
+  }
+
+  bool Save(const char* path) const {
+    std::ofstream out(path);
+    out << "# game size budget bias margin\n";
+    for (const auto& e : entries_) {
+      out << e.game << " " << e.size << " " << e.budget << (e.by_time ? "ms" : "it") << " "
+          << e.params.bias << " " << e.params.margin_weight << "\n";
+    }
+    return static_cast<bool>(out);
+  }
+
+  const std::vector<Entry>& entries() const { return entries_; }
+
+  // Adds an entry, or replaces the one for the same game, size and budget.
+  void Set(const Entry& entry) {
+    for (auto& e : entries_) {
+      if (e.game == entry.game && e.size == entry.size && e.by_time == entry.by_time && e.budget == entry.budget) {
+        e = entry;
+        return;
+      }
+    }
+    entries_.push_back(entry);
+  }
+
+  // The constants of the entry for the game and size whose budget of the
+  // same kind is the closest by ratio. Returns false if there is none.
+  bool Find(const std::string& game, const int size, const bool by_time, const size_t budget,
+            SearchParams& params) const {
+    const Entry* best = nullptr;
+    double best_distance = 0;
+    for (const auto& e : entries_) {
+      if (e.game != game || e.size != size || e.by_time != by_time) continue;
+      const double d = std::abs(std::log((e.budget + 1.0) / (budget + 1.0)));
+      if (!best || d < best_distance) {
+        best = &e;
+        best_distance = d;
+      }
+    }
+    if (best) params = best->params;
+    return best != nullptr;
+  }
+
+  // "1000it" or "100ms", up to MaxThinkingTime or MaxIterations; digits
+  // first, since strtoul would take a sign and wrap a negative budget
+  static bool ParseBudget(const std::string& s, bool& by_time, size_t& budget) {
+    if (!std::isdigit(static_cast<unsigned char>(s[0]))) return false;
+    char* end;
+    budget = std::strtoul(s.c_str(), &end, 10);
+    by_time = std::strcmp(end, "ms") == 0;
+    if (by_time) return budget <= MaxThinkingTime;
+    return std::strcmp(end, "it") == 0 && budget <= MaxIterations;
+  }
+
+ private:
+  std::vector<Entry> entries_;
+};
+
+}  // namespace player
@@ -0,0 +1,178 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <vector>
+#include "othello.hpp"
+#include "symmetry.hpp"
+
+namespace othello {
+
+// File layout: "MGPT" version:u8 board_size:u8 num_phases:u8 reserved:u8
+// num_weights:u64, then the weights as floats, in native byte order.
+struct PatternFileHeader {
+  char magic[4];
+  uint8_t version;
+  uint8_t board_size;
+  uint8_t num_phases;
+  uint8_t reserved;
+  uint64_t num_weights;
+};
+static_assert(sizeof(PatternFileHeader) == 16, "PatternFileHeader must be packed");
+
+// A linear evaluation by n-tuples. A pattern is a set of cells (a corner
+// region, an edge, a line or a diagonal) that is placed under every symmetry
+// of the board, and every configuration of its cells has a learned weight
+// for each phase of the game. Cells are read as empty, own or opponent's for
+// the player to move, so one set of weights serves both colors.
+template<BoardSize N>
+class PatternEvaluator {
+  static_assert(N == 8, "the patterns are laid out for 8x8 boards");
+
+ public:
+  static constexpr int NumPhases = 4;
+  static constexpr int MaxCells = 10;
+  static constexpr uint8_t Version = 1;
+
+  struct Pattern {
+    size_t offset;  // of its weights within a phase
+    int num_cells;
+    std::vector<std::array<int8_t, MaxCells>> placements;
+  };
+  using Patterns = std::vector<Pattern>;
+
+  PatternEvaluator() : weights_(GetNumWeights(), 0) {}
+
+  // the weights of a phase are those of every pattern, then a bias
+  static size_t GetPhaseSize() { return patterns_.back().offset + Power3(patterns_.back().num_cells) + 1; }
+  static size_t GetNumWeights() { return NumPhases * GetPhaseSize(); }
+
+  static int GetPhase(const Board<N>& board) {
+    return (board.num_darks() + board.num_lights() - 4) * NumPhases / (N * N - 3);
+  }
+
+  // Calls f(i) with the index of every weight that the evaluation of the
+  // board sums, once per pattern placement and once for the bias.
+  template<class F>
+  static void ForEachFeature(const Board<N>& board, F f) {
+    const Player p = board.current_player();
+    const auto& a = board.array();
+    std::array<uint8_t, N * N> cells;
+    for (int m = 0; m < N * N; ++m) {
+      const CellValue v = a[m];
+      cells[m] = IsEmpty(v) ? 0 : v == p ? 1 : 2;
+    }
+    const size_t base = GetPhase(board) * GetPhaseSize();
+    for (const auto& pattern : patterns_) {
+      for (const auto& placement : pattern.placements) {
+        size_t index = 0;
+        for (int k = 0; k < pattern.num_cells; ++k) index = index * 3 + cells[placement[k]];
+        f(base + pattern.offset + index);
+      }
+    }
+    f(base + GetPhaseSize() - 1);
+  }
+
+  // Expected final score for the player to move, on the scale of
+  // GameTraits::GetScore: the disc difference over the number of cells.
+  double Evaluate(const Board<N>& board) const {
+    double sum = 0;
+    ForEachFeature(board, [this, &sum] (const size_t i) { sum += weights_[i]; });
+    return std::max(-1.0, std::min(1.0, sum));
+  }
+
+  std::vector<float>& weights() { return weights_; }
+  const std::vector<float>& weights() const { return weights_; }
+
+  bool Load(const char* path) {
+    std::ifstream in(path, std::ios::binary);
+    PatternFileHeader h;
+    if (!in.read(reinterpret_cast<char*>(&h), sizeof(h)) ||
+        std::memcmp(h.magic, "MGPT", 4) != 0 || h.version != Version ||
+        h.board_size != N || h.num_phases != NumPhases || h.num_weights != GetNumWeights()) {
+      return false;
+    }
+    std::vector<float> weights(h.num_weights);
+    if (!in.read(reinterpret_cast<char*>(weights.data()), weights.size() * sizeof(float))) return false;
+    weights_.swap(weights);
+    return true;
+  }
+
+  bool Save(const char* path) const {
+    PatternFileHeader h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, "MGPT", 4);
+    h.version = Version;
+    h.board_size = N;
+    h.num_phases = NumPhases;
+    h.num_weights = weights_.size();
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    out.write(reinterpret_cast<const char*>(weights_.data()), weights_.size() * sizeof(float));
+    return static_cast<bool>(out);
+  }
+
+ private:
+  static size_t Power3(const int k) { return k ? 3 * Power3(k - 1) : 1; }
+
+  static Patterns BuildPatterns() {
+    std::vector<std::vector<int>> shapes;
+    auto cell = [] (const int i, const int j) { return i * N + j; };
+    std::vector<int> corner3x3, corner2x5, edge;
+    for (int i = 0; i < 3; ++i) {
+      for (int j = 0; j < 3; ++j) corner3x3.push_back(cell(i, j));
+    }
+    for (int i = 0; i < 2; ++i) {
+      for (int j = 0; j < 5; ++j) corner2x5.push_back(cell(i, j));
+    }
+    for (int j = 0; j < N; ++j) edge.push_back(cell(0, j));
+    edge.push_back(cell(1, 1));  // with both X-squares
+    edge.push_back(cell(1, N - 2));
+    shapes.push_back(corner3x3);
+    shapes.push_back(corner2x5);
+    shapes.push_back(edge);
+    for (int i = 1; i < 4; ++i) {
+      std::vector<int> line;
+      for (int j = 0; j < N; ++j) line.push_back(cell(i, j));
+      shapes.push_back(line);
+    }
+    for (int length = N; length >= 4; --length) {
+      std::vector<int> diagonal;
+      for (int i = 0; i < length; ++i) diagonal.push_back(cell(i, i + N - length));
+      shapes.push_back(diagonal);
+    }
+
+    Patterns patterns;
+    size_t offset = 0;
+    for (const auto& shape : shapes) {
+      Pattern pattern{offset, static_cast<int>(shape.size()), {}};
+      std::vector<std::vector<int>> seen;
+      for (int t = 0; t < symmetry::NumTransforms; ++t) {
+        std::array<int8_t, MaxCells> placement;
+        std::vector<int> sorted;
+        for (size_t k = 0; k < shape.size(); ++k) {
+          placement[k] = symmetry::TransformCell(t, shape[k], N);
+          sorted.push_back(placement[k]);
+        }
+        std::sort(sorted.begin(), sorted.end());
+        if (std::find(seen.begin(), seen.end(), sorted) != seen.end()) continue;
+        seen.push_back(sorted);
+        pattern.placements.push_back(placement);
+      }
+      offset += Power3(pattern.num_cells);
+      patterns.push_back(pattern);
+    }
+    return patterns;
+  }
+
+  static const Patterns patterns_;
+  std::vector<float> weights_;
+};
+
+template<BoardSize N>
+const typename PatternEvaluator<N>::Patterns PatternEvaluator<N>::patterns_ =
+    PatternEvaluator<N>::BuildPatterns();
+
+}  // namespace othello
@@ -0,0 +1,123 @@
+#pragma once
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace util {
+
+// Hardware counters of one thread, through perf_event_open. The counters
+// are opened as one group, so that they are read together with a single
+// system call; the ones the machine or the kernel does not provide read as
+// 0, and where none is available (no PMU in a VM, perf_event_paranoid, a
+// seccomp filter), ok() is false and every read gives zeros.
+class PerfCounters {
+ public:
+  enum Event { CYCLES, INSTRUCTIONS, BRANCH_MISSES, L1D_MISSES, LLC_MISSES, NumEvents };
+  using Values = std::array<uint64_t, NumEvents>;
+
+  PerfCounters() : leader_(-1), error_(0) {
+    fds_.fill(-1);
+    slots_.fill(-1);
+  }
+
+  PerfCounters(const PerfCounters&) = delete;
+  PerfCounters& operator=(const PerfCounters&) = delete;
+
+  ~PerfCounters() { Close(); }
+
+  static const char* GetName(const Event e) {
+    static const char* const names[NumEvents] = {
+        "cycles", "instructions", "branch_misses", "l1d_misses", "llc_misses"};
+    return names[e];
+  }
+
+  // Starts counting for the calling thread, in user space only. Returns
+  // whether any counter is available.
+  bool Open() {
+    Close();
+    int num_slots = 0;
+    for (int e = 0; e < NumEvents; ++e) {
+      perf_event_attr attr;
+      std::memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      GetConfig(static_cast<Event>(e), attr);
+      attr.disabled = leader_ < 0;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.read_format = PERF_FORMAT_GROUP;
+      const int fd = ::syscall(SYS_perf_event_open, &attr, 0, -1, leader_, 0);
+      if (fd < 0) {
+        if (!error_) error_ = errno;
+        continue;
+      }
+      if (leader_ < 0) leader_ = fd;
+      fds_[e] = fd;
+      slots_[e] = num_slots++;
+    }
+    if (leader_ < 0) return false;
+    ::ioctl(leader_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ::ioctl(leader_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    return true;
+  }
+
+  bool ok() const { return leader_ >= 0; }
+  bool has(const Event e) const { return fds_[e] >= 0; }
+
+  // errno of the first counter that could not be opened, or 0
+  int error() const { return error_; }
+
+  // the counts since Open
+  void Read(Values& v) const {
+    v.fill(0);
+    if (leader_ < 0) return;
+    uint64_t buffer[1 + NumEvents];  // the number of counters, then their values
+    if (::read(leader_, buffer, sizeof(buffer)) < static_cast<ssize_t>(sizeof(uint64_t))) return;
+    for (int e = 0; e < NumEvents; ++e) {
+      if (slots_[e] >= 0 && static_cast<uint64_t>(slots_[e]) < buffer[0]) v[e] = buffer[1 + slots_[e]];
+    }
+  }
+
+ private:
+  static void GetConfig(const Event e, perf_event_attr& attr) {
+    attr.type = PERF_TYPE_HARDWARE;
+    switch (e) {
+      case CYCLES: attr.config = PERF_COUNT_HW_CPU_CYCLES; break;
+      case INSTRUCTIONS: attr.config = PERF_COUNT_HW_INSTRUCTIONS; break;
+      case BRANCH_MISSES: attr.config = PERF_COUNT_HW_BRANCH_MISSES; break;
+      case L1D_MISSES:
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        break;
+      default: attr.config = PERF_COUNT_HW_CACHE_MISSES; break;  // last level
+    }
+  }
+
+  void Close() {
+    // the members first, then the leader
+    for (int e = NumEvents - 1; e >= 0; --e) {
+      if (fds_[e] >= 0 && fds_[e] != leader_) ::close(fds_[e]);
+    }
+    if (leader_ >= 0) ::close(leader_);
+    leader_ = -1;
+    fds_.fill(-1);
+    slots_.fill(-1);
+  }
+
+  int leader_;
+  int error_;
+  std::array<int, NumEvents> fds_;
+  std::array<int, NumEvents> slots_;  // positions in a group read
+};
+
+// a += b - c, counter by counter
+inline void AddDifference(PerfCounters::Values& a, const PerfCounters::Values& b, const PerfCounters::Values& c) {
+  for (size_t i = 0; i < a.size(); ++i) a[i] += b[i] - c[i];
+}
+
+}  // namespace util
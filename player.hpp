@@ -1,9 +1,23 @@
 #pragma once
+#include <algorithm>
+#include <array>
 #include <cassert>
 #include <chrono>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
 #include <iostream>
+#include <limits>
+#include <memory>
 #include <random>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "record.hpp"
+#include "stats.hpp"
+#include "symmetry.hpp"
 #include "util.hpp"
 
 namespace player {
@@ -64,6 +78,35 @@ class Random {
   RNG& rng_;
 };
 
+// File layout of a search tree snapshot: "MGTR" version:u8 board_size:u8
+// reserved:u16 game:char[8] num_moves:u32 reserved:u32 num_nodes:u64, then
+// the moves from the starting position to the root as i16, padded to a
+// multiple of 8 bytes, then the nodes in breadth-first order from the root.
+// The children of a node are contiguous, so a node refers to them by the
+// index of the first one; boards are not stored but replayed from the moves.
+struct TreeFileHeader {
+  char magic[4];
+  uint8_t version;
+  uint8_t board_size;
+  uint16_t reserved;
+  char game[8];
+  uint32_t num_moves;
+  uint32_t reserved2;
+  uint64_t num_nodes;
+};
+static_assert(sizeof(TreeFileHeader) == 32, "TreeFileHeader must be packed");
+
+struct TreeFileNode {
+  double num_wins;
+  uint64_t num_visited;
+  uint32_t first_child;  // 0 if not expanded
+  uint16_t num_children;
+  int16_t move;
+  uint8_t proof;
+  uint8_t reserved[7];
+};
+static_assert(sizeof(TreeFileNode) == 32, "TreeFileNode must be packed");
+
 template<class GameTraits, bool Debug = false, class RNG = std::mt19937>
 class GenericMCTS {
  public:
@@ -71,92 +114,470 @@ class GenericMCTS {
   using Move = typename GameTraits::Move;
   using Player = typename GameTraits::Player;
   using History = typename GameTraits::History;
+  // Estimates the final score of a position for the player to move, on the
+  // scale of GameTraits::GetScore.
+  using Evaluator = std::function<double(const Board&)>;
 
-  GenericMCTS(RNG& rng, int thinking_time)
+  GenericMCTS(RNG& rng, std::chrono::milliseconds thinking_time)
       : rng_(rng),
         bias_(1.4),
-        thinking_time_(thinking_time) {
+        thinking_time_(thinking_time),
+        max_iterations_(0),
+        playouts_per_leaf_(1),
+        symmetry_depth_(0),
+        draw_reward_(.5),
+        margin_weight_(0),
+        playout_cutoff_(0),
+        num_allocations_(0),
+        root_policy_(UCB),
+        num_root_candidates_(16),
+        num_rounds_(0),
+        round_(0),
+        next_candidate_(0),
+        phase_timing_(false),
+        stats_sink_(nullptr),
+        root_(nullptr),
+        resume_(false) {
   }
 
   void SetBias(const double b) { bias_ = b; }
 
+  void SetThinkingTime(const std::chrono::milliseconds t) { thinking_time_ = t; }
+
+  // Stops the search after exactly n iterations instead of after the thinking
+  // time, so that the same seed always produces the same move. 0 restores the
+  // time-bound search.
+  void SetMaxIterations(const size_t n) { max_iterations_ = n; }
+
+  // Runs k playouts from every expanded leaf and backpropagates them at once,
+  // which amortizes selection and backpropagation over k simulations.
+  void SetPlayoutsPerLeaf(const size_t k) { playouts_per_leaf_ = util::at_least_1(k); }
+
+  // Expands only one of the children that are equivalent under rotation and
+  // reflection, for nodes less than depth plies below the root. Symmetric
+  // positions are common in the opening, where this saves up to 8x the work.
+  void SetSymmetryDepth(const size_t depth) { symmetry_depth_ = depth; }
+
+  // A playout is rewarded 1 for a win, 0 for a loss and this for a draw.
+  void SetDrawReward(const double reward) { draw_reward_ = reward; }
+
+  // Mixes the final score margin (GameTraits::GetScore, scaled to [0, 1])
+  // into the reward with weight w, so that a playout tells a narrow win from
+  // a wide one. 0 rewards the outcome only.
+  void SetMarginWeight(const double w) { margin_weight_ = w; }
+
+  // Stops playouts after the given number of moves and scores the positions
+  // they reached with the evaluator instead; the score counts as a winning
+  // probability through a logistic curve. 0 plays every playout to the end.
+  void SetPlayoutCutoff(const size_t moves, Evaluator evaluator) {
+    playout_cutoff_ = evaluator ? moves : 0;
+    evaluator_ = std::move(evaluator);
+  }
+
+  // How the root spends the budget among its moves; the tree below it
+  // always uses UCB1.
+  //
+  // UCB: UCB1, as everywhere else.
+  // SEQUENTIAL_HALVING: the budget is split into log2(moves) rounds, each
+  //   shared evenly among the remaining moves, after which the worse half
+  //   of them is dropped. Small budgets are then not spread over every move
+  //   until the end, as by UCB1.
+  // GUMBEL: sequential halving over at most num_candidates moves drawn at
+  //   random, ranked by their value plus Gumbel noise that fades as they are
+  //   visited, as in Gumbel MuZero with a uniform prior.
+  enum RootPolicy : uint8_t { UCB, SEQUENTIAL_HALVING, GUMBEL };
+
+  void SetRootPolicy(const RootPolicy policy, const size_t num_candidates = 16) {
+    root_policy_ = policy;
+    num_root_candidates_ = util::at_least_1(num_candidates);
+  }
+
+  // Measures the time spent in each phase of the search. This reads the clock
+  // four times per iteration, so it is off by default.
+  void SetPhaseTiming(const bool enabled) { phase_timing_ = enabled; }
+
+  // Counts cycles, instructions, branch and cache misses in each phase of the
+  // search with hardware counters (see util::PerfCounters), which costs a
+  // system call per phase. The counters are opened by the thread of the
+  // first search; where they are unavailable nothing is counted.
+  void SetPerfCounters(const bool enabled) {
+    if (!enabled) {
+      perf_.reset();
+    } else if (!perf_) {
+      perf_.reset(new util::PerfCounters());
+    }
+  }
+
+  // the counters, if enabled, for their availability
+  const util::PerfCounters* perf_counters() const { return perf_.get(); }
+
+  // Asks for transparent huge pages for the search tree, which saves TLB
+  // misses on trees much larger than the caches.
+  void SetHugePages(const bool enabled) {
+    nodes_.SetHugePages(enabled);
+    values_.SetHugePages(enabled);
+  }
+
+  // Interleaves the search tree over the given NUMA nodes, a bit per node
+  // id, instead of keeping it on the node of the searching thread; see
+  // util::Arena::SetInterleave.
+  void SetInterleave(const uint64_t nodes) {
+    nodes_.SetInterleave(nodes);
+    values_.SetInterleave(nodes);
+  }
+
+  // Writes the stats of every move as a line of JSON to os; nullptr disables.
+  void SetStatsSink(std::ostream* os) { stats_sink_ = os; }
+
+  // stats of the most recent move, and of all moves since construction
+  const SearchStats& last_stats() const { return last_stats_; }
+  const SearchStats& total_stats() const { return total_stats_; }
+
   const char* GetName() const { return "GenericMCTS"; }
 
-  // for non-root nodes, (parent->board, this->move) -> this->board
+  static constexpr uint8_t TreeFileVersion = 1;
+
+  // Writes the tree of the most recent search, which is kept until the next
+  // one starts, for LoadTree. Returns false if there is none, if the history
+  // passed to that search does not lead to its board, or on a write error.
+  bool SaveTree(const char* path) const {
+    if (!root_ || !IsReachedBy(root_moves_, root_->board())) return false;
+    std::vector<const Node*> order(1, root_);
+    std::vector<TreeFileNode> records;
+    for (size_t i = 0; i < order.size(); ++i) {
+      const Node& node = *order[i];
+      if (node.num_children > 0xffff || order.size() > 0xffffffff) return false;
+      TreeFileNode r;
+      std::memset(&r, 0, sizeof(r));
+      r.num_wins = node.num_wins;
+      r.num_visited = node.num_visited;
+      r.first_child = node.num_children ? order.size() : 0;
+      r.num_children = node.num_children;
+      r.move = node.move;
+      r.proof = node.proof;
+      records.push_back(r);
+      for (size_t j = 0; j < node.num_children; ++j) order.push_back(&node.children[j]);
+    }
+    TreeFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, "MGTR", 4);
+    header.version = TreeFileVersion;
+    header.board_size = GameTraits::MaxPos;
+    std::strncpy(header.game, GameTraits::GetGameName(), sizeof(header.game));
+    header.num_moves = root_moves_.size();
+    header.num_nodes = records.size();
+    std::vector<int16_t> moves(root_moves_.begin(), root_moves_.end());
+    moves.resize((moves.size() + 3) / 4 * 4);
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(moves.data()), moves.size() * sizeof(int16_t));
+    out.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(TreeFileNode));
+    return static_cast<bool>(out);
+  }
+
+  // Reads a tree written by SaveTree, from a mapped file in a single pass.
+  // The next search continues it if its history is the saved one or extends
+  // it with moves along the tree; otherwise that search starts afresh.
+  // Returns false, keeping no tree, if the file is not a valid tree of this
+  // game and board size.
+  bool LoadTree(const char* path) {
+    nodes_.clear();
+    values_.clear();
+    root_ = nullptr;
+    resume_ = false;
+    util::MappedFile file(path);
+    TreeFileHeader header;
+    if (!file.ok() || file.size() < sizeof(header)) return false;
+    std::memcpy(&header, file.data(), sizeof(header));
+    const size_t moves_bytes = (static_cast<size_t>(header.num_moves) + 3) / 4 * 8;
+    if (std::memcmp(header.magic, "MGTR", 4) != 0 || header.version != TreeFileVersion ||
+        header.board_size != GameTraits::MaxPos ||
+        std::strncmp(header.game, GameTraits::GetGameName(), sizeof(header.game)) != 0 ||
+        header.num_nodes == 0 || file.size() < sizeof(header) + moves_bytes ||
+        (file.size() - sizeof(header) - moves_bytes) % sizeof(TreeFileNode) != 0 ||
+        header.num_nodes != (file.size() - sizeof(header) - moves_bytes) / sizeof(TreeFileNode)) {
+      return false;
+    }
+    const int16_t* moves = reinterpret_cast<const int16_t*>(file.data() + sizeof(header));
+    const TreeFileNode* records = reinterpret_cast<const TreeFileNode*>(file.data() + sizeof(header) + moves_bytes);
+
+    Board board;
+    for (size_t i = 0; i < header.num_moves; ++i) {
+      if (board.IsFinished() || !IsOnBoard(moves[i]) || !board.IsLegalMove(moves[i])) return false;
+      board.Next(static_cast<Move>(moves[i]));
+    }
+    // the children of the nodes in order are the nodes from 1 on, in order
+    uint64_t next = 1;
+    for (uint64_t i = 0; i < header.num_nodes; ++i) {
+      const TreeFileNode& r = records[i];
+      if (r.proof > DRAW || r.num_children > Nodes::ChunkSize ||
+          (r.num_children && r.first_child != next) || next + r.num_children > header.num_nodes) {
+        return false;
+      }
+      next += r.num_children;
+    }
+    if (next != header.num_nodes || !IsValidTree(records, board)) return false;
+
+    std::vector<Node*> nodes(header.num_nodes);
+    nodes[0] = new (nodes_.Allocate(1)) Node(nullptr, GameTraits::GetIllegalMove());
+    new (&nodes[0]->board_storage) Board(board);
+    nodes[0]->has_board = true;
+    for (uint64_t i = 0; i < header.num_nodes; ++i) {
+      const TreeFileNode& r = records[i];
+      Node& node = *nodes[i];
+      node.num_wins = r.num_wins;
+      node.num_visited = r.num_visited;
+      node.proof = static_cast<Proof>(r.proof);
+      const size_t k = r.num_children;
+      if (!k) continue;
+      node.children = nodes_.Allocate(k);
+      const size_t padded = util::PadToLanes(k);
+      node.values = values_.Allocate(2 * padded);
+      node.num_children = k;
+      float* explorations = node.explorations();
+      for (size_t j = 0; j < k; ++j) {
+        const TreeFileNode& c = records[r.first_child + j];
+        nodes[r.first_child + j] = new (&node.children[j]) Node(&node, static_cast<Move>(c.move));
+        if (c.proof != UNPROVEN) {
+          node.values[j] = GetProvenValue(static_cast<Proof>(c.proof));
+          explorations[j] = 0;
+        } else {
+          node.values[j] = c.num_visited ? c.num_wins / c.num_visited : 0;
+          explorations[j] = c.num_visited ? 1 / std::sqrt(static_cast<float>(c.num_visited)) : 1;
+        }
+      }
+      for (size_t j = k; j < padded; ++j) {
+        node.values[j] = -std::numeric_limits<float>::infinity();
+        explorations[j] = 0;
+      }
+    }
+    root_ = nodes[0];
+    root_moves_.assign(moves, moves + header.num_moves);
+    resume_ = true;
+    return true;
+  }
+
+  // Whether a stored move names a cell, checked before it is narrowed to
+  // Move, where a value off the board could alias one on it.
+  static bool IsOnBoard(const int16_t m) {
+    return m >= 0 && m < GameTraits::MaxPos * GameTraits::MaxPos;
+  }
+
+  // Whether every move of the tree whose root is board is legal and differs
+  // from those of its siblings. The walk plays and takes back the moves to
+  // the expanded nodes on board, which is unchanged on return.
+  static bool IsValidTree(const TreeFileNode* records, Board& board) {
+    struct Frame {
+      uint64_t node;
+      size_t next;                    // child to visit next
+      typename Board::UndoInfo undo;  // of the move to node
+    };
+    std::vector<bool> seen(GameTraits::MaxPos * GameTraits::MaxPos);
+    auto has_valid_children = [records, &board, &seen] (const TreeFileNode& r) {
+      size_t j = 0;
+      for (; j < r.num_children; ++j) {
+        const int16_t m = records[r.first_child + j].move;
+        if (!IsOnBoard(m) || !board.IsLegalMove(static_cast<Move>(m)) || seen[m]) break;
+        seen[m] = true;
+      }
+      for (size_t i = 0; i < j; ++i) seen[records[r.first_child + i].move] = false;
+      return j == r.num_children;
+    };
+    if (!has_valid_children(records[0])) return false;
+    std::vector<Frame> stack(1);
+    stack[0].node = 0;
+    stack[0].next = 0;
+    bool ok = true;
+    while (!stack.empty()) {
+      Frame& f = stack.back();
+      const TreeFileNode& r = records[f.node];
+      if (!ok || f.next == r.num_children) {
+        if (stack.size() > 1) board.Undo(f.undo);
+        stack.pop_back();
+        continue;
+      }
+      const uint64_t c = r.first_child + f.next++;
+      if (!records[c].num_children) continue;  // its move was checked with its siblings'
+      Frame child;
+      child.node = c;
+      child.next = 0;
+      board.Next(static_cast<Move>(records[c].move), child.undo);
+      stack.push_back(child);
+      ok = !board.IsFinished() && has_valid_children(records[c]);
+    }
+    return ok;
+  }
+
+  // visits of the root of the most recent search, or of the loaded tree
+  size_t root_visits() const { return root_ ? root_->num_visited : 0; }
+
+  // A node whose outcome is known under perfect play, from the point of view
+  // of the player who made its move, like num_wins. Proven nodes are never
+  // sampled again.
+  enum Proof : uint8_t { UNPROVEN, WIN, LOSS, DRAW };
+
+  // for non-root nodes, (parent->board(), this->move) -> this->board()
   struct Node {
-    double value;        // num_wins / num_visited
-    double num_wins;     // number of wins from the player who made the move
+    double num_wins;     // sum of the rewards of the player who made the move
     size_t num_visited;  // number of simulations from this and all descendant nodes
     Node* parent;
-    Node* child;
-    Node* sibling;
-    Board board;   // for root node: the initial game state; otherwise the resulting state
+    Node* children;      // num_children contiguous nodes, or nullptr if not expanded
+    float* values;       // per child: num_wins / num_visited, padded to util::PadToLanes
+    size_t num_children;
+    // for root node: the initial game state; otherwise the resulting state,
+    // which is left unconstructed until BuildBoard, since most children of
+    // an expanded node are never reached
+    typename std::aligned_storage<sizeof(Board), alignof(Board)>::type board_storage;
     Move move;     // for non-root nodes: the taken move from parent's state
+    Proof proof;
+    bool has_board;
+
+    Node(Node* parent, const Move move)
+        : num_wins(0), num_visited(0), parent(parent), children(nullptr), values(nullptr),
+          num_children(0), move(move), proof(UNPROVEN), has_board(false) {}
+
+    Board& board() { return *reinterpret_cast<Board*>(&board_storage); }
+    const Board& board() const { return *reinterpret_cast<const Board*>(&board_storage); }
+
+    // Plays the move on a copy of the parent's board, and proves the node if
+    // that ends the game.
+    void BuildBoard() {
+      if (has_board) return;
+      new (&board_storage) Board(parent->board());
+      board().Next(move);
+      has_board = true;
+      if (board().IsFinished()) {
+        proof = board().IsDraw() ? DRAW : board().winner() == GetPlayer() ? WIN : LOSS;
+      }
+    }
 
     // the player who played the taken move
     Player GetPlayer() const {
-      return parent ? parent->board.current_player() : board.current_player();
+      return parent ? parent->board().current_player() : board().current_player();
     }
+
+    // per child: 1 / sqrt(num_visited), the exploration term without sqrt(log n)
+    float* explorations() const { return values + util::PadToLanes(num_children); }
   };
-  using Nodes = util::FixedBulk<Node, 10000>;
+  using Nodes = util::Arena<Node, 10000>;
+  using Values = util::Arena<float, 1 << 16>;
 
   Move GetNextMove(const Board& board, const History& history) {
     const auto start_time = std::chrono::high_resolution_clock::now();
     Move m;
     size_t iter = 0;
+    SearchStats& stats = last_stats_;
+    stats.Clear();
     {
-      Node& root = nodes_.Create();
-      root.value = 0,
-      root.num_wins = 0;
-      root.num_visited = 0;
-      root.parent = nullptr;
-      root.child = nullptr;
-      root.sibling = nullptr;
-      root.board = board;
-      root.move = GameTraits::GetIllegalMove();
+      root_ = resume_ ? FindRoot(board, history) : nullptr;
+      resume_ = false;
+      if (!root_) {
+        nodes_.clear();
+        values_.clear();
+        root_ = new (nodes_.Allocate(1)) Node(nullptr, GameTraits::GetIllegalMove());
+        new (&root_->board_storage) Board(board);
+        root_->has_board = true;
+      }
+      root_moves_.clear();
+      for (const auto& e : history) root_moves_.push_back(record::GetMove(e));
+      Node& root = *root_;
+      if (perf_ && !perf_->ok() && !perf_->error()) perf_->Open();
+      PhaseTimer timer(phase_timing_, perf_.get());
+      candidates_.clear();
       do {
-        for (size_t j = 0; j < 100; ++j) {
+        const size_t batch = max_iterations_ ? std::min<size_t>(100, max_iterations_ - iter) : 100;
+        for (size_t j = 0; j < batch; ++j) {
+          if (root_policy_ != UCB && root.children && root.proof == UNPROVEN) {
+            if (candidates_.empty()) StartHalving(root);
+            if (max_iterations_) Halve(root, static_cast<double>(iter) / max_iterations_);
+          }
           ++iter;
-          Node& leaf = Select(root);
-          Node& child = leaf.board.IsFinished() ? leaf : Expand(leaf);
-          SimulateAndUpdate(child);
+          size_t depth = 0;
+          Node& leaf = candidates_.empty() ? Select(root, depth) : SelectCandidate(root, depth);
+          timer.Lap(stats.select_time, stats.select_counters);
+          Node* child = &leaf;
+          if (leaf.proof == UNPROVEN) {
+            child = &Expand(leaf, depth);
+            if (child != &leaf) ++depth;
+          }
+          timer.Lap(stats.expand_time, stats.expand_counters);
+          if (child->proof == UNPROVEN) Simulate(*child);
+          timer.Lap(stats.simulate_time, stats.simulate_counters);
+          Backpropagate(*child);
+          timer.Lap(stats.backprop_time, stats.backprop_counters);
+          stats.AddDepth(depth);
+          if (root.proof != UNPROVEN) break;
         }
-      } while (std::chrono::high_resolution_clock::now() - start_time < thinking_time_);
-      assert(root.child);
-      const Node* child = root.child;
-      const Node* best = child;
-      double best_value = best->value;
-      while (child->sibling) {
-        child = child->sibling;
-        if (child->value > best_value) {
-          best = child;
-          best_value = best->value;
+        if (!max_iterations_ && !candidates_.empty()) {
+          Halve(root, std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start_time) /
+                      thinking_time_);
+        }
+      } while (root.proof == UNPROVEN &&
+               (max_iterations_
+                ? iter < max_iterations_
+                : std::chrono::high_resolution_clock::now() - start_time < thinking_time_));
+      assert(root.children);
+      size_t best = 0;
+      if (!candidates_.empty() && root.proof == UNPROVEN) {
+        // the best of the moves left by sequential halving
+        best = candidates_[0].second;
+        for (const auto& c : candidates_) {
+          if (GetRootScore(root, c.second) > GetRootScore(root, best)) best = c.second;
+        }
+      } else {
+        for (size_t i = 1; i < root.num_children; ++i) {
+          if (root.values[i] > root.values[best]) best = i;
+        }
+      }
+      if (root.proof == LOSS) {
+        // every move loses: resist for as long as the search did
+        for (size_t i = 1; i < root.num_children; ++i) {
+          if (root.children[i].num_visited > root.children[best].num_visited) best = i;
         }
       }
       if (Debug) {
-        child = root.child;
-        while (child) {
+        for (size_t i = 0; i < root.num_children; ++i) {
           std::cout << "[GenericMCTS] Move: ";
-          GameTraits::PrintMove(std::cout, child->move);
-          std::cout << ", v_i = " << child->value
-                    << ", n_i = " << child->num_visited << std::endl;
-          child = child->sibling;
+          GameTraits::PrintMove(std::cout, root.children[i].move);
+          std::cout << ", v_i = " << root.values[i]
+                    << ", n_i = " << root.children[i].num_visited << std::endl;
         }
         std::cout << "[GenericMCTS] Choosen move: ";
-        GameTraits::PrintMove(std::cout, best->move);
-        std::cout << ", v_i = " << best->value
-                  << ", n_i = " << best->num_visited << std::endl;
+        GameTraits::PrintMove(std::cout, root.children[best].move);
+        std::cout << ", v_i = " << root.values[best]
+                  << ", n_i = " << root.children[best].num_visited << std::endl;
       }
-      m = best->move;
+      m = root.children[best].move;
+      const Proof proof = root.children[best].proof;
+      stats.value = proof == UNPROVEN ? root.values[best]
+          : proof == WIN ? 1 : proof == DRAW ? draw_reward_ : 0;
+      stats.solved = root.proof != UNPROVEN;
     }
     const size_t num_nodes = nodes_.size();
-    nodes_.clear();
+    const size_t num_allocations = nodes_.num_allocations() + values_.num_allocations();
+    stats.moves = 1;
+    stats.iterations = iter;
+    stats.playouts = iter * playouts_per_leaf_;
+    stats.nodes = num_nodes;
+    stats.memory_bytes = nodes_.capacity() * sizeof(Node)
+                         + values_.capacity() * sizeof(float)
+                         + playouts_.capacity() * sizeof(Board);
+    stats.used_bytes = num_nodes * sizeof(Node) + values_.size() * sizeof(float);
+    stats.allocations = num_allocations - num_allocations_;
+    num_allocations_ = num_allocations;
     const auto end_time = std::chrono::high_resolution_clock::now();
+    stats.time = end_time - start_time;
+    total_stats_.Merge(stats);
+    if (stats_sink_) {
+      stats.WriteJson(*stats_sink_);
+      *stats_sink_ << '\n';
+    }
     if (Debug) {
       const auto t = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time).count() / 1000000.0;
       std::cout << "[GenericMCTS] Iterated " << iter << " times for "
                 << t << " sec ("
-                << iter / t << " iter/s)" << std::endl
+                << iter / t << " iter/s, "
+                << iter * playouts_per_leaf_ / t << " playouts/s)" << std::endl
                 << "[GenericMCTS] " << num_nodes << " nodes created ("
                 << sizeof(Node) << " bytes/node, ~"
                 << num_nodes * sizeof(Node) << " bytes)" << std::endl;
@@ -165,71 +586,322 @@ class GenericMCTS {
   }
 
  private:
-  Node& Select(Node& root) {
-    const auto c = bias_;
+  static constexpr size_t SqrtLogTableSize = 4096;
+  // slope of the logistic curve from evaluated scores to winning probabilities
+  static constexpr double EvaluationGain = 10;
+  // c_visit and c_scale of Gumbel MuZero
+  static constexpr float GumbelVisitScale = 50;
+  static constexpr float GumbelValueScale = 1;
+  using SqrtLogTable = std::array<float, SqrtLogTableSize>;
+
+  static SqrtLogTable BuildSqrtLogTable() {
+    SqrtLogTable table;
+    for (size_t n = 0; n < SqrtLogTableSize; ++n) {
+      table[n] = std::sqrt(std::log(static_cast<double>(util::at_least_1(n))));
+    }
+    return table;
+  }
+
+  static float SqrtLog(const size_t n) {
+    return n < SqrtLogTableSize ? sqrt_log_[n] : std::sqrt(std::log(static_cast<double>(n)));
+  }
+
+  Node& Select(Node& root, size_t& depth) {
+    const float c = bias_;
     Node* leaf = &root;
-    while (leaf->child) {
-      const double logn = std::log(util::at_least_1(leaf->num_visited));
-      auto q_value = [logn, c] (const Node* n) { 
-        return n->value + c * std::sqrt(logn / util::at_least_1(n->num_visited));
-      };
-      leaf = leaf->child;
-      double ucb = q_value(leaf);
-      Node* child = leaf;
-      while (child->sibling) {
-        child = child->sibling;
-        const double v = q_value(child);
-        if (v > ucb) {
-          ucb = v;
-          leaf = child;
+    while (leaf->children && leaf->proof == UNPROVEN) {
+      ++depth;
+      // value + c * sqrt(log n / n_i) == value + (c * sqrt(log n)) * (1 / sqrt(n_i))
+      const size_t i = util::ArgMaxMulAdd(leaf->values, leaf->explorations(),
+                                          c * SqrtLog(leaf->num_visited), leaf->num_children);
+      leaf = &leaf->children[i];
+      // built on the way down rather than in Expand, for the nodes of a
+      // loaded tree, which come without boards
+      leaf->BuildBoard();
+    }
+    return *leaf;
+  }
+
+  // Picks the next of the root's candidates in turn, skipping proven ones,
+  // and descends from it with UCB1.
+  Node& SelectCandidate(Node& root, size_t& depth) {
+    for (size_t k = 0; k < candidates_.size(); ++k) {
+      Node& child = root.children[candidates_[next_candidate_].second];
+      next_candidate_ = (next_candidate_ + 1) % candidates_.size();
+      if (child.proof == UNPROVEN) {
+        ++depth;
+        return Select(child, depth);
+      }
+    }
+    return Select(root, depth);  // every candidate is proven
+  }
+
+  // Chooses the root's candidates once it is expanded.
+  void StartHalving(const Node& root) {
+    const size_t k = root.num_children;
+    candidates_.clear();
+    if (root_policy_ == GUMBEL) {
+      // the top of the Gumbel noise is a uniform sample without replacement
+      std::extreme_value_distribution<float> gumbel(0, 1);
+      gumbels_.resize(k);
+      for (size_t i = 0; i < k; ++i) {
+        gumbels_[i] = gumbel(rng_);
+        candidates_.emplace_back(gumbels_[i], i);
+      }
+      const size_t m = std::min(num_root_candidates_, k);
+      std::partial_sort(candidates_.begin(), candidates_.begin() + m, candidates_.end(), ByScore);
+      candidates_.resize(m);
+    } else {
+      for (size_t i = 0; i < k; ++i) candidates_.emplace_back(0, i);
+    }
+    num_rounds_ = 1;
+    while (size_t{1} << num_rounds_ < candidates_.size()) ++num_rounds_;
+    round_ = 0;
+    next_candidate_ = 0;
+  }
+
+  // Drops the worse half of the candidates for every round that the search
+  // has finished, given the part of the budget spent so far.
+  void Halve(const Node& root, const double progress) {
+    while (round_ + 1 < num_rounds_ && progress * num_rounds_ >= round_ + 1) {
+      ++round_;
+      for (auto& c : candidates_) c.first = GetRootScore(root, c.second);
+      std::sort(candidates_.begin(), candidates_.end(), ByScore);
+      candidates_.resize((candidates_.size() + 1) / 2);
+      next_candidate_ = 0;
+    }
+  }
+
+  // higher scores first, then lower indices, so that the order is the same
+  // on every platform
+  static bool ByScore(const std::pair<float, size_t>& a, const std::pair<float, size_t>& b) {
+    return a.first > b.first || (a.first == b.first && a.second < b.second);
+  }
+
+  float GetRootScore(const Node& root, const size_t i) const {
+    if (root_policy_ != GUMBEL) return root.values[i];
+    // sigma(q) of Gumbel MuZero: the value outweighs the noise as the
+    // candidates are visited
+    size_t max_visited = 0;
+    for (const auto& c : candidates_) {
+      max_visited = std::max(max_visited, root.children[c.second].num_visited);
+    }
+    return gumbels_[i] + (GumbelVisitScale + max_visited) * GumbelValueScale * root.values[i];
+  }
+
+  // Expands node and returns the child to simulate from, or node itself if
+  // it turns out to end the game.
+  Node& Expand(Node& node, const size_t depth) {
+    node.BuildBoard();
+    if (node.proof != UNPROVEN) return node;
+    const auto moves = node.board().GetLegalMoves();
+    size_t k = moves.size();
+    node.children = nodes_.Allocate(k);
+    for (size_t i = 0; i < k; ++i) new (&node.children[i]) Node(&node, moves[i]);
+    if (depth < symmetry_depth_) {
+      for (size_t i = 0; i < k; ++i) node.children[i].BuildBoard();
+      k = MergeSymmetricChildren(node.children, k);
+    } else if (node.board().MayEndNext()) {
+      // the children that end the game are proven now, playing and taking
+      // back their moves on this board, so that an immediate win is found
+      // without building every child's board; MayEndNext spares the probes
+      // where no move can end the game, which is most of the time
+      Board& board = node.board();
+      typename Board::UndoInfo undo;
+      for (size_t i = 0; i < k; ++i) {
+        Node& child = node.children[i];
+        board.Next(child.move, undo);
+        if (board.IsFinished()) {
+          child.proof = board.IsDraw() ? DRAW : board.winner() == undo.player ? WIN : LOSS;
         }
+        board.Undo(undo);
       }
     }
-    return *leaf;
+    const size_t padded = util::PadToLanes(k);
+    node.values = values_.Allocate(2 * padded);
+    node.num_children = k;
+    float* explorations = node.explorations();
+    for (size_t i = 0; i < k; ++i) {
+      node.values[i] = 0;
+      explorations[i] = 1;
+    }
+    for (size_t i = k; i < padded; ++i) {
+      node.values[i] = -std::numeric_limits<float>::infinity();
+      explorations[i] = 0;
+    }
+    // a winning move proves the node at once
+    for (size_t i = 0; i < k; ++i) {
+      if (node.children[i].proof == WIN) return node.children[i];
+    }
+    std::uniform_int_distribution<> dis(0, k - 1);
+    Node& child = node.children[dis(rng_)];
+    child.BuildBoard();
+    return child;
+  }
+
+  // Keeps only the first of the children that are equivalent under rotation
+  // and reflection, and returns how many are left.
+  size_t MergeSymmetricChildren(Node* children, const size_t k) {
+    keys_.clear();
+    for (size_t i = 0; i < k; ++i) {
+      keys_.emplace_back(symmetry::GetCanonicalKey<GameTraits>(children[i].board()).key, i);
+    }
+    std::sort(keys_.begin(), keys_.end());
+    keep_.assign(k, false);
+    for (size_t i = 0; i < k; ++i) {
+      if (i == 0 || keys_[i].first != keys_[i - 1].first) keep_[keys_[i].second] = true;
+    }
+    size_t n = 0;
+    for (size_t i = 0; i < k; ++i) {
+      if (keep_[i]) children[n++] = children[i];
+    }
+    return n;
   }
 
-  Node& Expand(Node& node) {
-    const auto i = nodes_.size();
-    for (const auto m : node.board.GetLegalMoves()) {
-      Node& child = nodes_.Create();
-      child.value = 0;
-      child.num_wins = 0;
-      child.num_visited = 0;
-      child.parent = &node;
-      child.child = nullptr;
-      child.sibling = nullptr;
-      child.board = node.board;
-      child.move = m;
-      child.board.Next(m);
-      if (node.child) child.sibling = node.child;
-      node.child = &child;
-    }
-    std::uniform_int_distribution<> dis(i, nodes_.size() - 1);
-    return nodes_[dis(rng_)];
-  }
-
-  void SimulateAndUpdate(Node& node) {
-    Board board = node.board;
-    while (!board.IsFinished()) {
-      const auto m = GetRandomMove(board);
-      board.Next(m);
-    }
-    const auto winner = board.winner();
-    const bool draw = board.IsDraw();
+  void Simulate(const Node& node) {
+    // advance the playouts one move at a time in round robin, so that the
+    // independent boards are worked on together and stay in cache
+    playouts_.assign(playouts_per_leaf_, node.board());
+    size_t num_active = playouts_.size();
+    for (size_t length = 0; num_active; ++length) {
+      if (playout_cutoff_ && length == playout_cutoff_) {
+        // the rest are scored by the evaluator
+        for (size_t i = 0; i < num_active; ++i) last_stats_.AddPlayoutLength(length);
+        break;
+      }
+      size_t i = 0;
+      while (i < num_active) {
+        Board& board = playouts_[i];
+        if (board.IsFinished()) {
+          last_stats_.AddPlayoutLength(length);
+          std::swap(board, playouts_[--num_active]);
+        } else {
+          board.Next(GetRandomMove(board));
+          ++i;
+        }
+      }
+    }
+  }
+
+  void Backpropagate(Node& node) {
+    // in a two-player game every node's player is either the leaf's player or
+    // the opponent, so two counters are enough to update the whole path
+    const Player player = node.GetPlayer();
+    const size_t k = playouts_per_leaf_;
+    double player_reward = 0;
+    double opponent_reward = 0;
+    if (node.proof == WIN) {
+      player_reward = k;
+    } else if (node.proof == LOSS) {
+      opponent_reward = k;
+    } else if (node.proof == DRAW) {
+      player_reward = opponent_reward = k * draw_reward_;
+    } else {
+      const double w = margin_weight_;
+      for (const auto& board : playouts_) {
+        double outcome, opponent_outcome, margin;
+        if (board.IsFinished()) {
+          outcome = board.IsDraw() ? draw_reward_ : board.winner() == player ? 1 : 0;
+          opponent_outcome = board.IsDraw() ? draw_reward_ : 1 - outcome;
+          margin = w ? (GameTraits::GetScore(board, player) + 1) / 2 : 0;
+        } else {
+          const double score = board.current_player() == player
+              ? evaluator_(board) : -evaluator_(board);
+          outcome = 1 / (1 + std::exp(-EvaluationGain * score));
+          opponent_outcome = 1 - outcome;
+          margin = (score + 1) / 2;
+        }
+        player_reward += (1 - w) * outcome + w * margin;
+        opponent_reward += (1 - w) * opponent_outcome + w * (1 - margin);
+      }
+    }
     Node* p = &node;
     for (;;) {
-      ++p->num_visited;
-      if (p->GetPlayer() == winner) {
-        p->num_wins += 1;
-      } else if (draw) {
-        //p->num_wins += .5;
-      }
-      p->value = p->num_wins / p->num_visited;
+      p->num_visited += k;
+      p->num_wins += p->GetPlayer() == player ? player_reward : opponent_reward;
       if (!p->parent) break;
-      p = p->parent;
+      Node* parent = p->parent;
+      const size_t i = p - parent->children;
+      if (p->proof == UNPROVEN) {
+        parent->values[i] = p->num_wins / p->num_visited;
+        parent->explorations()[i] = 1 / std::sqrt(static_cast<float>(p->num_visited));
+      } else {
+        parent->values[i] = GetProvenValue(p->proof);
+        parent->explorations()[i] = 0;
+        if (parent->proof == UNPROVEN) Prove(*parent, *p);
+      }
+      p = parent;
     }
   }
 
+  float GetProvenValue(const Proof proof) const {
+    return proof == WIN ? std::numeric_limits<float>::infinity()
+        : proof == LOSS ? -std::numeric_limits<float>::infinity()
+        : draw_reward_;
+  }
+
+  // Proves node if its newly proven child wins for the player to move, or if
+  // all of its children are proven.
+  static void Prove(Node& node, const Node& child) {
+    Proof best = child.proof;  // for the player to move at node
+    for (size_t i = 0; i < node.num_children && best != WIN; ++i) {
+      const Proof proof = node.children[i].proof;
+      if (proof == UNPROVEN) return;
+      if (proof == WIN || proof == DRAW) best = proof;
+    }
+    if (node.GetPlayer() == node.board().current_player() || best == DRAW) {
+      node.proof = best;
+    } else {
+      node.proof = best == WIN ? LOSS : WIN;
+    }
+  }
+
+  // The node of the loaded tree that history reaches from its root, as the
+  // root of the next search, if it is expanded, unproven and its board is
+  // board; nullptr otherwise.
+  Node* FindRoot(const Board& board, const History& history) {
+    if (history.size() < root_moves_.size()) return nullptr;
+    for (size_t i = 0; i < root_moves_.size(); ++i) {
+      if (record::GetMove(history[i]) != root_moves_[i]) return nullptr;
+    }
+    Node* node = root_;
+    for (size_t i = root_moves_.size(); i < history.size() && node; ++i) {
+      const Move m = record::GetMove(history[i]);
+      Node* child = nullptr;
+      for (size_t j = 0; j < node->num_children && !child; ++j) {
+        if (node->children[j].move == m) child = &node->children[j];
+      }
+      if (child) child->BuildBoard();
+      node = child;
+    }
+    if (!node || !node->children || node->proof != UNPROVEN || !IsSamePosition(node->board(), board)) {
+      return nullptr;
+    }
+    // as the root, the node's wins count for the player to move, not for the
+    // player of its move; the search does not read them, but backs up into
+    // them and saves them, so they start again
+    node->parent = nullptr;
+    node->num_wins = 0;
+    return node;
+  }
+
+  // whether the moves lead from the starting position to board
+  static bool IsReachedBy(const std::vector<int>& moves, const Board& board) {
+    Board b;
+    for (const int m : moves) {
+      if (b.IsFinished() || !b.IsLegalMove(m)) return false;
+      b.Next(m);
+    }
+    return IsSamePosition(b, board);
+  }
+
+  static bool IsSamePosition(const Board& a, const Board& b) {
+    std::vector<std::pair<int, int>> stones[2];
+    a.ForEachStone([&stones] (const int m, const int v) { stones[0].emplace_back(m, v); });
+    b.ForEachStone([&stones] (const int m, const int v) { stones[1].emplace_back(m, v); });
+    return a.current_player() == b.current_player() && stones[0] == stones[1];
+  }
+
   Move GetRandomMove(const Board& board) {
     const auto legal_moves = board.GetLegalMoves();
     assert(!legal_moves.empty());
@@ -240,7 +912,40 @@ class GenericMCTS {
   RNG& rng_;
   double bias_;
   std::chrono::milliseconds thinking_time_;
+  size_t max_iterations_;
+  size_t playouts_per_leaf_;
+  size_t symmetry_depth_;
+  double draw_reward_;
+  double margin_weight_;
+  size_t playout_cutoff_;
+  Evaluator evaluator_;
   Nodes nodes_;
+  Values values_;
+  size_t num_allocations_;  // chunks allocated by the arenas before this move
+  std::vector<Board> playouts_;
+  std::vector<std::pair<uint64_t, size_t>> keys_;
+  std::vector<bool> keep_;
+  RootPolicy root_policy_;
+  size_t num_root_candidates_;
+  std::vector<std::pair<float, size_t>> candidates_;  // of the root: score, child index
+  std::vector<float> gumbels_;                        // per root child
+  size_t num_rounds_;
+  size_t round_;
+  size_t next_candidate_;
+  bool phase_timing_;
+  std::unique_ptr<util::PerfCounters> perf_;
+  std::ostream* stats_sink_;
+  SearchStats last_stats_;
+  SearchStats total_stats_;
+  Node* root_;                    // of the most recent search or the loaded tree
+  std::vector<int> root_moves_;   // from the starting position to root_
+  bool resume_;                   // whether the next search may continue root_
+
+  static const SqrtLogTable sqrt_log_;
 };
 
+template<class GameTraits, bool Debug, class RNG>
+const typename GenericMCTS<GameTraits, Debug, RNG>::SqrtLogTable
+GenericMCTS<GameTraits, Debug, RNG>::sqrt_log_ = GenericMCTS<GameTraits, Debug, RNG>::BuildSqrtLogTable();
+
 }  // namespace player
@@ -0,0 +1,223 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace record {
+
+// Binary game records. All integers are little endian.
+//
+//   file   := "MAGO" version:u8 board_size:u8 move_bytes:u8 reserved:u8
+//             game:str num_players:u8 player:str*
+//   record := seed1:u64 seed2:u64 black:u8 white:u8 winner:u8 reserved:u8
+//             num_moves:u16 move*
+//   str    := length:u8 byte*
+//
+// A move is its index on the board in move_bytes bytes (1 for boards up to
+// 15x15, 2 otherwise), or all ones for the illegal move that ended a game.
+// Records are packed back to back, so a mapped file can be read in place.
+
+constexpr const uint8_t Version = 1;
+constexpr const char Magic[4] = {'M', 'A', 'G', 'O'};
+constexpr const size_t RecordHeaderSize = 22;
+
+// the move of a history entry, for both gomoku and othello histories
+template<class M>
+inline M GetMove(const M m) { return m; }
+
+template<class P, class M>
+inline M GetMove(const std::pair<P, M>& e) { return e.second; }
+
+struct GameInfo {
+  uint64_t seeds[2];   // whatever reproduces the players, e.g. their RNG seeds
+  uint8_t players[2];  // black/dark and white/light, as indices into the player names
+  uint8_t winner;
+};
+
+template<class GameTraits>
+inline constexpr uint8_t GetMoveBytes() {
+  return GameTraits::MaxPos * GameTraits::MaxPos < 0xff ? 1 : 2;
+}
+
+template<class GameTraits>
+class Writer {
+ public:
+  using Move = typename GameTraits::Move;
+  using History = typename GameTraits::History;
+
+  Writer(std::ostream& os, const std::vector<std::string>& players) : os_(os), num_records_(0) {
+    buffer_.append(Magic, sizeof(Magic));
+    PutU8(Version);
+    PutU8(GameTraits::MaxPos);
+    PutU8(GetMoveBytes<GameTraits>());
+    PutU8(0);
+    PutString(GameTraits::GetGameName());
+    PutU8(players.size());
+    for (const auto& name : players) PutString(name);
+    Flush();
+  }
+
+  ~Writer() { Flush(); }
+
+  size_t num_records() const { return num_records_; }
+
+  // history is a GameTraits::History or any sequence of moves
+  template<class H = History>
+  void Write(const GameInfo& info, const H& history) {
+    PutU64(info.seeds[0]);
+    PutU64(info.seeds[1]);
+    PutU8(info.players[0]);
+    PutU8(info.players[1]);
+    PutU8(info.winner);
+    PutU8(0);
+    PutU16(history.size());
+    for (const auto& e : history) {
+      const int m = GetMove(e);
+      if (GetMoveBytes<GameTraits>() == 1) {
+        PutU8(m < 0 ? 0xff : m);
+      } else {
+        PutU16(m < 0 ? 0xffff : m);
+      }
+    }
+    ++num_records_;
+    if (buffer_.size() >= 1 << 16) Flush();
+  }
+
+  void Flush() {
+    os_.write(buffer_.data(), buffer_.size());
+    buffer_.clear();
+  }
+
+ private:
+  void PutU8(const uint8_t v) { buffer_.push_back(static_cast<char>(v)); }
+  void PutU16(const uint16_t v) { PutU8(v); PutU8(v >> 8); }
+  void PutU64(const uint64_t v) { for (int i = 0; i < 64; i += 8) PutU8(v >> i); }
+
+  void PutString(const std::string& s) {
+    const size_t n = s.size() < 0xff ? s.size() : 0xff;
+    PutU8(n);
+    buffer_.append(s, 0, n);
+  }
+
+  std::ostream& os_;
+  std::string buffer_;
+  size_t num_records_;
+};
+
+template<class GameTraits>
+struct Record {
+  using Move = typename GameTraits::Move;
+
+  GameInfo info;
+  size_t num_moves;
+  const uint8_t* moves;
+
+  Move move(const size_t i) const {
+    if (GetMoveBytes<GameTraits>() == 1) {
+      const uint8_t m = moves[i];
+      return m == 0xff ? GameTraits::GetIllegalMove() : m;
+    } else {
+      const uint16_t m = moves[2 * i] | (moves[2 * i + 1] << 8);
+      return m == 0xffff ? GameTraits::GetIllegalMove() : m;
+    }
+  }
+};
+
+// Reads records in place from a buffer, typically a util::MappedFile.
+template<class GameTraits>
+class Reader {
+ public:
+  Reader(const uint8_t* data, const size_t size) : p_(data), end_(data + size), ok_(false) {
+    if (size < 8 || std::memcmp(data, Magic, sizeof(Magic)) != 0) return;
+    p_ += sizeof(Magic);
+    const uint8_t version = GetU8();
+    const uint8_t board_size = GetU8();
+    const uint8_t move_bytes = GetU8();
+    GetU8();
+    std::string game;
+    if (version != Version || board_size != GameTraits::MaxPos ||
+        move_bytes != GetMoveBytes<GameTraits>() ||
+        !GetString(game) || game != GameTraits::GetGameName() || p_ == end_) {
+      return;
+    }
+    players_.resize(GetU8());
+    for (auto& name : players_) {
+      if (!GetString(name)) return;
+    }
+    ok_ = true;
+  }
+
+  // false if the header is malformed or for another game or board size
+  bool ok() const { return ok_; }
+
+  const std::vector<std::string>& players() const { return players_; }
+
+  // Reads the next record; returns false at the end or on a truncated record.
+  bool Next(Record<GameTraits>& r) {
+    if (!ok_ || static_cast<size_t>(end_ - p_) < RecordHeaderSize) return false;
+    r.info.seeds[0] = GetU64();
+    r.info.seeds[1] = GetU64();
+    r.info.players[0] = GetU8();
+    r.info.players[1] = GetU8();
+    r.info.winner = GetU8();
+    GetU8();
+    r.num_moves = GetU16();
+    r.moves = p_;
+    const size_t n = r.num_moves * GetMoveBytes<GameTraits>();
+    if (static_cast<size_t>(end_ - p_) < n) {
+      p_ = end_;
+      return false;
+    }
+    p_ += n;
+    return true;
+  }
+
+ private:
+  uint8_t GetU8() { return *p_++; }
+  uint16_t GetU16() { const uint16_t v = p_[0] | (p_[1] << 8); p_ += 2; return v; }
+
+  uint64_t GetU64() {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; ++i) v |= static_cast<uint64_t>(p_[i]) << (8 * i);
+    p_ += 8;
+    return v;
+  }
+
+  bool GetString(std::string& s) {
+    if (p_ == end_) return false;
+    const size_t n = GetU8();
+    if (static_cast<size_t>(end_ - p_) < n) return false;
+    s.assign(reinterpret_cast<const char*>(p_), n);
+    p_ += n;
+    return true;
+  }
+
+  const uint8_t* p_;
+  const uint8_t* end_;
+  bool ok_;
+  std::vector<std::string> players_;
+};
+
+// Plays the moves of r on board, which should be at the starting position,
+// calling visit(board, move) before each move. Returns false if it stopped
+// at an illegal move.
+template<class GameTraits, class Visitor>
+bool Replay(const Record<GameTraits>& r, typename GameTraits::Board& board, Visitor visit) {
+  for (size_t i = 0; i < r.num_moves; ++i) {
+    const auto m = r.move(i);
+    if (!board.IsLegalMove(m)) return false;
+    visit(static_cast<const typename GameTraits::Board&>(board), m);
+    board.Next(m);
+  }
+  return true;
+}
+
+template<class GameTraits>
+bool Replay(const Record<GameTraits>& r, typename GameTraits::Board& board) {
+  return Replay(r, board, [] (const typename GameTraits::Board&, typename GameTraits::Move) {});
+}
+
+}  // namespace record
@@ -0,0 +1,158 @@
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "dispatch.hpp"
+#include "display.hpp"
+#include "player.hpp"
+#include "record.hpp"
+#include "selfplay.hpp"
+
+// Generates random games in bulk with selfplay::Engine and optionally writes
+// them as game records. --baseline instead plays the same number of games
+// with GameTraits::Play between two player::Random, for comparison.
+//
+// Records carry the seeds (seed, game), which identify the run and the game
+// in it; a game is reproduced by rerunning with the same --seed and --lanes
+// (or --baseline), not from its seeds alone.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+  std::string game = "othello";
+  int size = 8;
+  size_t games = 100000;
+  size_t lanes = 256;
+  size_t seed = 1;
+  bool baseline = false;
+  std::string record;  // writes the games to this file
+};
+
+bool ParseOption(Options& opt, const char* arg) {
+  const char* eq = std::strchr(arg, '=');
+  if (std::strncmp(arg, "--", 2) != 0 || !eq) return false;
+  const std::string key(arg + 2, eq);
+  const char* value = eq + 1;
+  if (key == "game") return dispatch::ParseGame(value, opt.game, opt.size);
+  else if (key == "games") opt.games = std::strtoul(value, nullptr, 10);
+  else if (key == "lanes") opt.lanes = std::strtoul(value, nullptr, 10);
+  else if (key == "seed") opt.seed = std::strtoul(value, nullptr, 10);
+  else if (key == "baseline") opt.baseline = std::atoi(value) != 0;
+  else if (key == "record") opt.record = value;
+  else return false;
+  return true;
+}
+
+struct Totals {
+  size_t wins[2];
+  size_t draws;
+  size_t moves;
+
+  template<class P>
+  void Add(const P winner, const P first, const size_t num_moves) {
+    if (winner == 0) {
+      ++draws;
+    } else {
+      ++wins[winner == first ? 0 : 1];
+    }
+    moves += num_moves;
+  }
+};
+
+struct SelfPlay {
+  const Options& opt;
+  int status;
+
+  template<class GT>
+  void Run() {
+    if (!opt.baseline && !selfplay::IsSupported<GT>::value) {
+      std::cerr << "The lockstep engine does not support " << GT::GetGameName() << " on "
+                << static_cast<int>(GT::MaxPos) << "x" << static_cast<int>(GT::MaxPos) << std::endl;
+      status = 1;
+      return;
+    }
+    const auto first = typename GT::Board().current_player();
+    std::unique_ptr<std::ofstream> out;
+    std::unique_ptr<record::Writer<GT>> writer;
+    if (!opt.record.empty()) {
+      out.reset(new std::ofstream(opt.record, std::ios::binary));
+      writer.reset(new record::Writer<GT>(*out, {"Random"}));
+    }
+    Totals totals{{0, 0}, 0, 0};
+    const auto start_time = Clock::now();
+    if (opt.baseline) {
+      ui::NullDisplay display;
+      std::mt19937 rng(opt.seed);
+      player::Random<GT> p1(rng);
+      player::Random<GT> p2(rng);
+      for (size_t i = 0; i < opt.games; ++i) {
+        typename GT::Board b;
+        typename GT::GameResult result;
+        GT::Play(b, p1, p2, result, display);
+        totals.Add(result.winner, first, result.history.size());
+        if (writer) writer->Write(record::GameInfo{{opt.seed, i}, {0, 0}, result.winner}, result.history);
+      }
+    } else {
+      RunEngine<GT>(first, totals, writer.get());
+    }
+    const double seconds =
+        std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start_time).count() / 1e6;
+    std::cout << "Game = " << GT::GetGameName() << " " << static_cast<int>(GT::MaxPos) << "x"
+              << static_cast<int>(GT::MaxPos) << (opt.baseline ? " (baseline)" : "") << std::endl
+              << "Games = " << opt.games << std::endl
+              << "Wins = " << totals.wins[0] << " " << totals.wins[1] << " (draws " << totals.draws << ")" << std::endl
+              << "Moves = " << totals.moves << std::endl
+              << "Time = " << seconds << " sec" << std::endl
+              << "Throughput = " << opt.games / seconds << " games/s, " << totals.moves / seconds << " moves/s"
+              << std::endl;
+  }
+
+  // the engine is only instantiated for the games it supports
+  template<class GT, class P>
+  void RunEngine(const P first, Totals& totals, record::Writer<GT>* writer) {
+    RunEngine<GT>(first, totals, writer, std::integral_constant<bool, selfplay::IsSupported<GT>::value>());
+  }
+
+  template<class GT, class P>
+  void RunEngine(const P, Totals&, record::Writer<GT>*, std::false_type) {}
+
+  template<class GT, class P>
+  void RunEngine(const P first, Totals& totals, record::Writer<GT>* writer, std::true_type) {
+    using Move = typename GT::Move;
+    selfplay::Engine<GT> engine(util::at_least_1(opt.lanes), opt.seed);
+    engine.Play(opt.games, [this, first, &totals, writer] (const size_t game, const P winner,
+                                                           const std::vector<Move>& moves) {
+      totals.Add(winner, first, moves.size());
+      if (writer) writer->Write(record::GameInfo{{opt.seed, game}, {0, 0}, winner}, moves);
+    });
+  }
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options opt;
+  for (int i = 1; i < argc; ++i) {
+    if (!ParseOption(opt, argv[i])) {
+      std::cerr << "usage: " << argv[0]
+                << " [--game=gomoku|othello[:SIZE]] [--games=N] [--lanes=N] [--seed=N]"
+                << " [--baseline=0|1] [--record=FILE]" << std::endl;
+      return 1;
+    }
+  }
+  SelfPlay selfplay{opt, 0};
+  if (!dispatch::Run(opt.game, opt.size, selfplay)) {
+    std::cerr << "Unsupported " << opt.game << " board size " << opt.size
+              << "; supported sizes are " << dispatch::GetSupportedSizes(opt.game) << std::endl;
+    return 1;
+  }
+  return selfplay.status;
+}
@@ -0,0 +1,274 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+#include "bitboard.hpp"
+#include "gomoku.hpp"
+#include "othello.hpp"
+#include "record.hpp"
+#include "util.hpp"
+
+namespace selfplay {
+
+// One xorshift64* generator per lane, all stepped together in a loop over
+// plain arrays that the compiler vectorizes.
+class LaneRandom {
+ public:
+  LaneRandom(const size_t num_lanes, uint64_t seed) : states_(num_lanes), outputs_(num_lanes) {
+    for (auto& s : states_) {
+      // splitmix64, so that nearby seeds give unrelated lanes
+      seed += 0x9e3779b97f4a7c15ull;
+      uint64_t z = seed;
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+      s = (z ^ (z >> 31)) | 1;
+    }
+  }
+
+  // the next 32 random bits of every lane
+  const uint32_t* Next() {
+    const size_t n = states_.size();
+    uint64_t* __restrict__ s = states_.data();
+    uint32_t* __restrict__ out = outputs_.data();
+    for (size_t i = 0; i < n; ++i) {
+      uint64_t x = s[i];
+      x ^= x >> 12;
+      x ^= x << 25;
+      x ^= x >> 27;
+      s[i] = x;
+      out[i] = (x * 0x2545f4914f6cdd1dull) >> 32;
+    }
+    return out;
+  }
+
+  // a number in [0, n) from random bits r
+  static uint32_t Pick(const uint32_t r, const uint32_t n) {
+    return static_cast<uint64_t>(r) * n >> 32;
+  }
+
+ private:
+  std::vector<uint64_t> states_;
+  std::vector<uint32_t> outputs_;
+};
+
+// The random games of a number of lanes, as arrays indexed by lane. Each
+// game has Reset(lane) to start it and Step(lane, r) to play a uniformly
+// random legal move with random bits r, which returns true once the game is
+// over; winner(lane) and the moves played are then valid until the next
+// Reset.
+template<class GameTraits>
+class Lanes;
+
+template<class GameTraits>
+struct IsSupported : std::true_type {};
+
+// bitboards of 128 cells at most
+template<uint8_t N>
+struct IsSupported<othello::GameTraits<N>> : std::integral_constant<bool, N * N <= 128> {};
+
+// Gomoku keeps a cell array and a list of the empty cells per lane. A move
+// is swapped with the last empty cell, so that it is drawn in constant time
+// and the moves played pile up at the end of the list, latest nearest the
+// front.
+template<uint8_t N>
+class Lanes<gomoku::GameTraits<N>> {
+ public:
+  using Move = gomoku::Move;
+  static constexpr int NumCells = N * N;
+
+  explicit Lanes(const size_t num_lanes)
+      : cells_(num_lanes * NumCells), empties_(num_lanes * NumCells), num_empties_(num_lanes),
+        players_(num_lanes), winners_(num_lanes) {}
+
+  void Reset(const size_t lane) {
+    std::fill_n(&cells_[lane * NumCells], NumCells, gomoku::NONE);
+    Move* e = &empties_[lane * NumCells];
+    for (int m = 0; m < NumCells; ++m) e[m] = m;
+    num_empties_[lane] = NumCells;
+    players_[lane] = gomoku::BLACK;
+    winners_[lane] = gomoku::NONE;
+  }
+
+  bool Step(const size_t lane, const uint32_t r) {
+    Move* e = &empties_[lane * NumCells];
+    const int n = num_empties_[lane]--;
+    const int k = LaneRandom::Pick(r, n);
+    const Move m = e[k];
+    e[k] = e[n - 1];
+    e[n - 1] = m;
+    uint8_t* cells = &cells_[lane * NumCells];
+    const gomoku::Player p = players_[lane];
+    cells[m] = p;
+    if (IsFive(cells, m, p)) {
+      winners_[lane] = p;
+      return true;
+    }
+    players_[lane] = gomoku::GetOppositePlayer(p);
+    return n == 1;
+  }
+
+  gomoku::Player winner(const size_t lane) const { return winners_[lane]; }
+
+  template<class H>
+  void GetHistory(const size_t lane, H& history) const {
+    const Move* e = &empties_[lane * NumCells];
+    for (int i = NumCells - 1; i >= num_empties_[lane]; --i) history.push_back(e[i]);
+  }
+
+ private:
+  using Lines = util::Lines<int16_t, N, gomoku::K>;
+
+  // the rule of gomoku::Board: exactly K stones in a row
+  static bool IsFive(const uint8_t* cells, const Move m, const gomoku::Player p) {
+    for (int d = 0; d < 4; ++d) {
+      int k = 1;
+      for (int e = 0; e < 2; ++e) {
+        for (const auto i : lines_[m][d][e]) {
+          if (i < 0 || cells[i] != p) break;
+          ++k;
+        }
+      }
+      if (k == gomoku::K) return true;
+    }
+    return false;
+  }
+
+  static const Lines lines_;
+  std::vector<uint8_t> cells_;
+  std::vector<Move> empties_;
+  std::vector<int> num_empties_;
+  std::vector<gomoku::Player> players_;
+  std::vector<gomoku::Player> winners_;
+};
+
+template<uint8_t N>
+const typename Lanes<gomoku::GameTraits<N>>::Lines Lanes<gomoku::GameTraits<N>>::lines_ =
+    util::BuildLines<int16_t, N, gomoku::K>();
+
+// Othello keeps a bitboard and the moves of the player to move per lane.
+// Passes are resolved right after each move, so a game in play always has a
+// move, and are left out of the history as in records.
+template<uint8_t N>
+class Lanes<othello::GameTraits<N>> {
+ public:
+  using Move = othello::Move;
+  using BitBoard = othello::BitBoard<N>;
+  using Bits = typename BitBoard::Bits;
+
+  explicit Lanes(const size_t num_lanes)
+      : boards_(num_lanes), moves_(num_lanes), darks_to_move_(num_lanes), histories_(num_lanes * N * N),
+        lengths_(num_lanes), winners_(num_lanes) {}
+
+  void Reset(const size_t lane) {
+    boards_[lane] = BitBoard::GetStartingPosition();
+    moves_[lane] = boards_[lane].GetMoves();
+    darks_to_move_[lane] = true;
+    lengths_[lane] = 0;
+    winners_[lane] = othello::NONE;
+  }
+
+  bool Step(const size_t lane, const uint32_t r) {
+    Bits moves = moves_[lane];
+    for (int k = LaneRandom::Pick(r, othello::PopCount(moves)); k; --k) moves &= moves - 1;
+    const int m = othello::FirstBit(moves);
+    histories_[lane * N * N + lengths_[lane]++] = m;
+    BitBoard& b = boards_[lane];
+    b.Play(m);
+    darks_to_move_[lane] ^= 1;
+    moves = b.GetMoves();
+    if (!moves) {
+      b.Pass();
+      darks_to_move_[lane] ^= 1;
+      moves = b.GetMoves();
+      if (!moves) {
+        const int d = darks_to_move_[lane] ? b.GetDifference() : -b.GetDifference();
+        winners_[lane] = d > 0 ? othello::DARK : d < 0 ? othello::LIGHT : othello::NONE;
+        return true;
+      }
+    }
+    moves_[lane] = moves;
+    return false;
+  }
+
+  othello::Player winner(const size_t lane) const { return winners_[lane]; }
+
+  template<class H>
+  void GetHistory(const size_t lane, H& history) const {
+    const Move* h = &histories_[lane * N * N];
+    history.insert(history.end(), h, h + lengths_[lane]);
+  }
+
+ private:
+  std::vector<BitBoard> boards_;
+  std::vector<Bits> moves_;
+  std::vector<uint8_t> darks_to_move_;
+  std::vector<Move> histories_;
+  std::vector<int> lengths_;
+  std::vector<othello::Player> winners_;
+};
+
+// Plays many random games at once: every lane advances its game by one move
+// per round, and a finished game is handed over and its lane restarted,
+// until the requested number of games is played. Compared with a loop over
+// GameTraits::Play between two player::Random, there are no move vectors,
+// player objects or displays, and the work of a round is spread over
+// boards that stay in cache.
+template<class GameTraits>
+class Engine {
+ public:
+  using Move = typename GameTraits::Move;
+
+  Engine(const size_t num_lanes, const uint64_t seed)
+      : lanes_(num_lanes), random_(num_lanes, seed), active_(num_lanes), num_lanes_(num_lanes) {}
+
+  // Plays num_games games, calling f(game, winner, moves) for each, in the
+  // order they finish, with its index by start and its moves in a vector.
+  template<class F>
+  void Play(const size_t num_games, F f) {
+    std::vector<size_t> games(num_lanes_);
+    size_t num_started = 0;
+    for (size_t lane = 0; lane < num_lanes_; ++lane) {
+      active_[lane] = num_started < num_games;
+      if (!active_[lane]) continue;
+      lanes_.Reset(lane);
+      games[lane] = num_started++;
+    }
+    size_t num_active = std::min(num_lanes_, num_games);
+    std::vector<Move> history;
+    while (num_active) {
+      const uint32_t* r = random_.Next();
+      for (size_t lane = 0; lane < num_lanes_; ++lane) {
+        if (!active_[lane] || !lanes_.Step(lane, r[lane])) continue;
+        history.clear();
+        lanes_.GetHistory(lane, history);
+        f(games[lane], lanes_.winner(lane), static_cast<const std::vector<Move>&>(history));
+        if (num_started < num_games) {
+          lanes_.Reset(lane);
+          games[lane] = num_started++;
+        } else {
+          active_[lane] = false;
+          --num_active;
+        }
+      }
+    }
+  }
+
+  // Plays num_games games into a record stream. The seeds of a record are
+  // (seed, game): they name the run and the game's place in it, but do not
+  // reproduce the game alone, whose moves depend on the lane it ran in and
+  // on the number of lanes. The same seed and lanes replay the whole run.
+  void Write(const size_t num_games, const uint64_t seed, record::Writer<GameTraits>& writer) {
+    Play(num_games, [seed, &writer] (const size_t game, const uint8_t winner, const std::vector<Move>& moves) {
+      writer.Write(record::GameInfo{{seed, game}, {0, 0}, winner}, moves);
+    });
+  }
+
+ private:
+  Lanes<GameTraits> lanes_;
+  LaneRandom random_;
+  std::vector<uint8_t> active_;
+  size_t num_lanes_;
+};
+
+}  // namespace selfplay
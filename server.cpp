@@ -0,0 +1,330 @@
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "dispatch.hpp"
+#include "params.hpp"
+#include "player.hpp"
+#include "worker_pool.hpp"
+
+// A long-running engine process. It reads one position per line from stdin
+// or from the clients of a Unix domain socket, searches the positions
+// concurrently on a pool of warm engines, and writes one JSON line per
+// position as soon as its search is done, in completion order.
+//
+// Request:  ID GAME BUDGET [MOVE...]
+//   ID      any token, echoed back in the response
+//   GAME    gomoku or othello, optionally with a board size such as othello:6
+//   BUDGET  a thinking time such as 100ms, or an iteration count such as 5000it,
+//           up to 60000ms or 10000000it
+//   MOVE    i,j with 1-based row and column, the moves played so far
+//
+// Response: {"id":"ID","move":[i,j],"stats":{...}}  or  {"id":"ID","error":"..."}
+//
+// With --params, each search uses the constants tuned by bin/tune for its
+// game, size and the nearest budget, where the table has them.
+
+namespace {
+
+struct Options {
+  std::string socket;
+  size_t threads = std::thread::hardware_concurrency();
+  size_t seed = 1;
+  double bias = .4;
+  std::string params;  // table of tuned search constants
+  bool pin = false;  // pins the workers over the NUMA nodes
+};
+
+struct Request {
+  std::string id;
+  std::string game;
+  int size;
+  bool by_time;
+  size_t budget;
+  std::vector<std::pair<int, int>> moves;
+};
+
+// One side of a conversation: where requests come from and responses go.
+class Channel {
+ public:
+  Channel(const int in, const int out, const bool owned) : in_(in), out_(out), owned_(owned) {}
+
+  ~Channel() {
+    if (owned_) ::close(in_);
+  }
+
+  int in() const { return in_; }
+
+  void Write(const std::string& line) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t n = 0;
+    while (n < line.size()) {
+      const ssize_t r = ::write(out_, line.data() + n, line.size() - n);
+      if (r <= 0) return;  // the client has gone away
+      n += r;
+    }
+  }
+
+ private:
+  int in_;
+  int out_;
+  bool owned_;
+  std::mutex mutex_;
+};
+
+std::string Quote(const std::string& s) {
+  std::string q = "\"";
+  for (const char c : s) {
+    if (c == '"' || c == '\\') q += '\\';
+    q += c;
+  }
+  return q + "\"";
+}
+
+std::string Error(const std::string& id, const std::string& message) {
+  return "{\"id\":" + Quote(id) + ",\"error\":" + Quote(message) + "}\n";
+}
+
+bool ParseRequest(const std::string& line, Request& r, std::string& error) {
+  std::istringstream in(line);
+  std::string game;
+  std::string budget;
+  if (!(in >> r.id >> game >> budget)) {
+    error = "expected: ID GAME BUDGET [MOVE...]";
+    return false;
+  }
+  if (!dispatch::ParseGame(game, r.game, r.size)) {
+    error = "unknown game: " + game;
+    return false;
+  }
+  if (!player::ParamTable::ParseBudget(budget, r.by_time, r.budget)) {
+    error = "bad budget: " + budget;
+    return false;
+  }
+  std::string move;
+  while (in >> move) {
+    int i, j;
+    char comma;
+    std::istringstream m(move);
+    if (!(m >> i >> comma >> j) || comma != ',') {
+      error = "bad move: " + move;
+      return false;
+    }
+    r.moves.emplace_back(i, j);
+  }
+  return true;
+}
+
+// A warm engine for one game and board size; it keeps its node pools between
+// requests. The virtual call is made once per request, and the search behind
+// it is specialized for the size.
+class Engine {
+ public:
+  virtual ~Engine() {}
+  virtual std::string Search(const Request& r, size_t seed) = 0;
+};
+
+template<class GT>
+class EngineFor : public Engine {
+ public:
+  EngineFor(const double bias, const player::ParamTable* table)
+      : bias_(bias), table_(table), mcts_(rng_, std::chrono::milliseconds(0)) {}
+
+  std::string Search(const Request& r, const size_t seed) override {
+    typename GT::Board board;
+    for (const auto& ij : r.moves) {
+      const auto m = board.GetMove(ij.first, ij.second);
+      if (ij.first < 1 || ij.first > GT::MaxPos || ij.second < 1 || ij.second > GT::MaxPos ||
+          !board.IsLegalMove(m)) {
+        return Error(r.id, "illegal move: " + std::to_string(ij.first) + "," + std::to_string(ij.second));
+      }
+      board.Next(m);
+    }
+    if (board.IsFinished()) return Error(r.id, "the game has finished");
+
+    // seeded by the request, so the answer does not depend on the worker
+    std::seed_seq seq{seed, std::hash<std::string>()(r.id)};
+    rng_.seed(seq);
+    // the tuned constants for the nearest budget, if any
+    player::SearchParams params{bias_, 0};
+    if (table_) table_->Find(r.game, r.size, r.by_time, r.budget, params);
+    player::ApplyParams(params, mcts_);
+    mcts_.SetMaxIterations(r.by_time ? 0 : util::at_least_1(r.budget));
+    mcts_.SetThinkingTime(std::chrono::milliseconds(r.budget));
+    const auto m = mcts_.GetNextMove(board, typename GT::History());
+
+    std::ostringstream os;
+    os << "{\"id\":" << Quote(r.id)
+       << ",\"move\":[" << m / GT::MaxPos + 1 << "," << m % GT::MaxPos + 1 << "]"
+       << ",\"stats\":";
+    mcts_.last_stats().WriteJson(os);
+    os << "}\n";
+    return os.str();
+  }
+
+ private:
+  double bias_;
+  const player::ParamTable* table_;
+  std::mt19937 rng_;
+  player::GenericMCTS<GT> mcts_;
+};
+
+struct MakeEngine {
+  template<class GT>
+  void Run() { engine.reset(new EngineFor<GT>(bias, table)); }
+
+  double bias;
+  const player::ParamTable* table;
+  std::unique_ptr<Engine> engine;
+};
+
+// The engines of one worker, created on the first request for their game and
+// board size.
+class Engines {
+ public:
+  Engines(const double bias, const player::ParamTable* table) : bias_(bias), table_(table) {}
+
+  // Returns null if the size is not supported.
+  Engine* Get(const std::string& game, const int size) {
+    auto& engine = engines_[std::make_pair(game, size)];
+    if (!engine) {
+      MakeEngine make{bias_, table_, nullptr};
+      if (!dispatch::Run(game, size, make)) return nullptr;
+      engine = std::move(make.engine);
+    }
+    return engine.get();
+  }
+
+ private:
+  double bias_;
+  const player::ParamTable* table_;
+  std::map<std::pair<std::string, int>, std::unique_ptr<Engine>> engines_;
+};
+
+std::string Handle(Engines& engines, const std::string& line, const Options& opt) {
+  Request r;
+  std::string error;
+  if (!ParseRequest(line, r, error)) return Error(r.id, error);
+  Engine* engine = engines.Get(r.game, r.size);
+  if (!engine) {
+    return Error(r.id, "unsupported " + r.game + " board size " + std::to_string(r.size) +
+                 "; supported sizes are " + dispatch::GetSupportedSizes(r.game));
+  }
+  return engine->Search(r, opt.seed);
+}
+
+// Reads lines from the channel and queues a search for each of them.
+void Serve(const std::shared_ptr<Channel>& channel,
+           util::WorkerPool& pool,
+           std::vector<std::unique_ptr<Engines>>& engines,
+           const Options& opt) {
+  std::string buffer;
+  char chunk[4096];
+  for (;;) {
+    const ssize_t n = ::read(channel->in(), chunk, sizeof(chunk));
+    if (n <= 0) break;
+    buffer.append(chunk, n);
+    size_t start = 0;
+    size_t eol;
+    while ((eol = buffer.find('\n', start)) != std::string::npos) {
+      const std::string line = buffer.substr(start, eol - start);
+      start = eol + 1;
+      if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+      pool.Submit([channel, line, &engines, &opt] (const size_t worker) {
+        channel->Write(Handle(*engines[worker], line, opt));
+      });
+    }
+    buffer.erase(0, start);
+  }
+}
+
+int Listen(const std::string& path) {
+  sockaddr_un addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(addr.sun_path)) return -1;
+  std::strcpy(addr.sun_path, path.c_str());
+  const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) return -1;
+  ::unlink(path.c_str());
+  if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || ::listen(fd, 64) < 0) {
+    ::close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+bool ParseOption(Options& opt, const char* arg) {
+  const char* eq = std::strchr(arg, '=');
+  if (std::strncmp(arg, "--", 2) != 0 || !eq) return false;
+  const std::string key(arg + 2, eq);
+  const char* value = eq + 1;
+  if (key == "socket") opt.socket = value;
+  else if (key == "threads") opt.threads = std::strtoul(value, nullptr, 10);
+  else if (key == "seed") opt.seed = std::strtoul(value, nullptr, 10);
+  else if (key == "bias") opt.bias = std::strtod(value, nullptr);
+  else if (key == "params") opt.params = value;
+  else if (key == "pin") opt.pin = std::atoi(value) != 0;
+  else return false;
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options opt;
+  for (int i = 1; i < argc; ++i) {
+    if (!ParseOption(opt, argv[i])) {
+      std::cerr << "usage: " << argv[0]
+                << " [--socket=PATH] [--threads=N] [--seed=N] [--bias=X] [--params=FILE] [--pin=0|1]" << std::endl;
+      return 1;
+    }
+  }
+  opt.threads = util::at_least_1(opt.threads);
+  std::signal(SIGPIPE, SIG_IGN);  // a client may leave before its answers are written
+  player::ParamTable table;
+  if (!opt.params.empty() && !table.Load(opt.params.c_str())) {
+    std::cerr << "Cannot read the parameter table " << opt.params << std::endl;
+    return 1;
+  }
+
+  std::vector<std::unique_ptr<Engines>> engines;
+  for (size_t i = 0; i < opt.threads; ++i) {
+    engines.emplace_back(new Engines(opt.bias, opt.params.empty() ? nullptr : &table));
+  }
+  // the engines allocate their trees on their worker's first request, so a
+  // pinned worker keeps them on its own node
+  const auto topology = util::Topology::Read();
+  util::WorkerPool pool(opt.threads, opt.pin ? &topology : nullptr);
+
+  if (opt.socket.empty()) {
+    Serve(std::make_shared<Channel>(STDIN_FILENO, STDOUT_FILENO, false), pool, engines, opt);
+    pool.Wait();
+    return 0;
+  }
+  const int fd = Listen(opt.socket);
+  if (fd < 0) {
+    std::cerr << "Cannot listen on " << opt.socket << ": " << std::strerror(errno) << std::endl;
+    return 1;
+  }
+  std::cerr << "Listening on " << opt.socket << std::endl;
+  for (;;) {
+    const int client = ::accept(fd, nullptr, nullptr);
+    if (client < 0) continue;
+    std::thread(Serve, std::make_shared<Channel>(client, client, true),
+                std::ref(pool), std::ref(engines), std::cref(opt)).detach();
+  }
+}
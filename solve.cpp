@@ -0,0 +1,114 @@
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include "bitboard.hpp"
+#include "dispatch.hpp"
+#include "othello.hpp"
+#include "solver.hpp"
+
+// Solves othello on a small board: the final disc difference for dark under
+// perfect play from the starting position, and dark's best first move. The
+// positions a few plies in are solved in parallel with work stealing, over a
+// shared table that may be kept in a file; with a checkpoint file an
+// interrupted run resumes without solving those positions again.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+  int size = 4;
+  size_t threads = std::thread::hardware_concurrency();
+  std::string table;       // file backing the table; anonymous memory if empty
+  int table_bits = 22;     // 2^bits entries of 16 bytes
+  std::string checkpoint;
+  int split = 6;
+};
+
+bool ParseOption(Options& opt, const char* arg) {
+  const char* eq = std::strchr(arg, '=');
+  if (std::strncmp(arg, "--", 2) != 0 || !eq) return false;
+  const std::string key(arg + 2, eq);
+  const char* value = eq + 1;
+  if (key == "size") opt.size = std::atoi(value);
+  else if (key == "threads") opt.threads = std::strtoul(value, nullptr, 10);
+  else if (key == "table") opt.table = value;
+  else if (key == "table-bits") opt.table_bits = std::atoi(value);
+  else if (key == "checkpoint") opt.checkpoint = value;
+  else if (key == "split") opt.split = std::atoi(value);
+  else return false;
+  return true;
+}
+
+double GetSeconds(const Clock::duration d) {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(d).count() / 1000.0;
+}
+
+struct Solve {
+  const Options& opt;
+  int status;
+
+  template<class GT>
+  void Run() {
+    constexpr othello::BoardSize N = GT::MaxPos;
+    othello::SolverTable table;
+    if (!table.Open(opt.table.c_str(), opt.table_bits, N)) {
+      std::cerr << "Cannot map a table of 2^" << opt.table_bits << " entries"
+                << (opt.table.empty() ? "" : " from " + opt.table) << std::endl;
+      status = 1;
+      return;
+    }
+    othello::Solver<N> solver(table);
+    solver.SetNumThreads(opt.threads);
+    solver.SetSplitDepth(opt.split);
+    if (!opt.checkpoint.empty()) solver.SetCheckpoint(opt.checkpoint);
+    const auto start_time = Clock::now();
+    auto last_report = start_time;
+    solver.SetProgress([&start_time, &last_report] (const size_t done, const size_t total, const uint64_t nodes) {
+      const auto now = Clock::now();
+      if (now - last_report < std::chrono::seconds(10) && done < total) return;
+      last_report = now;
+      std::cerr << "Solved " << done << "/" << total << " positions, "
+                << static_cast<uint64_t>(nodes / GetSeconds(now - start_time + std::chrono::milliseconds(1)))
+                << " nodes/s" << std::endl;
+    });
+
+    typename othello::Solver<N>::Result result;
+    if (!solver.Solve(othello::BitBoard<N>::GetStartingPosition(), result)) {
+      std::cerr << "Cannot use the checkpoint " << opt.checkpoint << std::endl;
+      status = 1;
+      return;
+    }
+    const double seconds = GetSeconds(Clock::now() - start_time);
+    std::cout << "Board = " << static_cast<int>(N) << "x" << static_cast<int>(N) << std::endl
+              << "Value = " << result.value << " (for dark)" << std::endl
+              << "Best move = (" << result.move / N + 1 << ", " << result.move % N + 1 << ")" << std::endl
+              << "Split positions = " << result.num_tasks << " (" << result.num_resumed << " resumed)" << std::endl
+              << "Nodes = " << result.nodes << std::endl
+              << "Time = " << seconds << " sec" << std::endl
+              << "Nodes/s = " << static_cast<uint64_t>(result.nodes / std::max(seconds, .001)) << std::endl;
+  }
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options opt;
+  for (int i = 1; i < argc; ++i) {
+    if (!ParseOption(opt, argv[i])) {
+      std::cerr << "usage: " << argv[0]
+                << " [--size=4|6|8] [--threads=N] [--table=FILE] [--table-bits=N]"
+                << " [--checkpoint=FILE] [--split=PLIES]" << std::endl;
+      return 1;
+    }
+  }
+  Solve solve{opt, 0};
+  if (!dispatch::RunSize<othello::GameTraits>(dispatch::Sizes<4, 6, 8>(), opt.size, solve)) {
+    std::cerr << "Unsupported board size " << opt.size << "; supported sizes are 4,6,8" << std::endl;
+    return 1;
+  }
+  return solve.status;
+}
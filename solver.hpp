@@ -0,0 +1,484 @@
+#pragma once
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "bitboard.hpp"
+#include "worker_pool.hpp"
+
+namespace othello {
+
+// File layout of a solver table: "MGTT" version:u8 board_size:u8 bits:u8
+// reserved:u8 num_entries:u64, then the entries, in native byte order.
+struct SolverTableHeader {
+  char magic[4];
+  uint8_t version;
+  uint8_t board_size;
+  uint8_t bits;
+  uint8_t reserved;
+  uint64_t num_entries;
+};
+static_assert(sizeof(SolverTableHeader) == 16, "SolverTableHeader must be packed");
+
+// A transposition table of exact bounds on final disc differences, shared
+// by every thread without locks. An entry stores its data and the key xor
+// the data, so that an entry torn by a concurrent write fails the key check
+// instead of yielding wrong bounds. Entries come in pairs: the first keeps
+// the position with the most empties, the second is always replaced. The
+// table lives in an anonymous mapping, or in a shared file mapping that keeps
+// the solved positions for later runs and lets the kernel page it out when it
+// does not fit in memory.
+class SolverTable {
+ public:
+  static constexpr uint8_t Version = 1;
+
+  SolverTable() : map_(nullptr), map_size_(0), entries_(nullptr), mask_(0) {}
+  ~SolverTable() { Close(); }
+
+  SolverTable(const SolverTable&) = delete;
+  SolverTable& operator=(const SolverTable&) = delete;
+
+  // Maps a table of 2^bits entries for n x n boards, from path if it is not
+  // empty; an existing file made for other settings is rejected.
+  bool Open(const char* path, const int bits, const BoardSize n) {
+    Close();
+    const uint64_t num_entries = uint64_t{1} << bits;
+    const size_t size = sizeof(SolverTableHeader) + num_entries * sizeof(Entry);
+    if (!path || !*path) {
+      void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (p == MAP_FAILED) return false;
+      map_ = p;
+    } else {
+      const int fd = open(path, O_RDWR | O_CREAT, 0644);
+      if (fd < 0) return false;
+      struct stat st;
+      const bool fresh = fstat(fd, &st) == 0 && st.st_size == 0;
+      if ((fresh && ftruncate(fd, size) != 0) || (!fresh && static_cast<size_t>(st.st_size) != size)) {
+        close(fd);
+        return false;
+      }
+      void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      close(fd);
+      if (p == MAP_FAILED) return false;
+      map_ = p;
+    }
+    map_size_ = size;
+    auto* h = static_cast<SolverTableHeader*>(map_);
+    if (h->magic[0] == 0) {
+      std::memcpy(h->magic, "MGTT", 4);
+      h->version = Version;
+      h->board_size = n;
+      h->bits = bits;
+      h->num_entries = num_entries;
+    } else if (std::memcmp(h->magic, "MGTT", 4) != 0 || h->version != Version ||
+               h->board_size != n || h->num_entries != num_entries) {
+      Close();
+      return false;
+    }
+    entries_ = reinterpret_cast<Entry*>(h + 1);
+    mask_ = num_entries - 1;
+    return true;
+  }
+
+  // Writes a file-backed table back to its file and unmaps it.
+  void Close() {
+    if (!map_) return;
+    msync(map_, map_size_, MS_SYNC);
+    munmap(map_, map_size_);
+    map_ = nullptr;
+    entries_ = nullptr;
+  }
+
+  bool ok() const { return map_ != nullptr; }
+  size_t size_bytes() const { return map_size_; }
+
+  // the bounds and best move stored for key, if any
+  bool Probe(const uint64_t key, int& lower, int& upper, int& move) const {
+    const Entry* e = &entries_[key & mask_ & ~uint64_t{1}];
+    for (int k = 0; k < 2; ++k) {
+      const uint64_t check = __atomic_load_n(&e[k].check, __ATOMIC_RELAXED);
+      const uint64_t data = __atomic_load_n(&e[k].data, __ATOMIC_RELAXED);
+      if ((check ^ data) != key || !(data & Valid)) continue;
+      lower = static_cast<int>(data & 0xff) - Offset;
+      upper = static_cast<int>(data >> 8 & 0xff) - Offset;
+      move = static_cast<int>(data >> 16 & 0xff);
+      if (move == 0xff) move = -1;
+      return true;
+    }
+    return false;
+  }
+
+  void Store(const uint64_t key, const int lower, const int upper, const int move, const int empties) {
+    Entry* e = &entries_[key & mask_ & ~uint64_t{1}];
+    const uint64_t old = __atomic_load_n(&e[0].data, __ATOMIC_RELAXED);
+    const bool same = (__atomic_load_n(&e[0].check, __ATOMIC_RELAXED) ^ old) == key;
+    if (!same && static_cast<int>(old >> 24 & 0xff) > empties) ++e;
+    const uint64_t data = Valid | static_cast<uint64_t>(empties) << 24 |
+                          static_cast<uint64_t>(move & 0xff) << 16 |
+                          static_cast<uint64_t>(upper + Offset) << 8 | static_cast<uint64_t>(lower + Offset);
+    __atomic_store_n(&e->check, key ^ data, __ATOMIC_RELAXED);
+    __atomic_store_n(&e->data, data, __ATOMIC_RELAXED);
+  }
+
+ private:
+  static constexpr int Offset = 64;  // bounds are stored as bound + Offset
+  static constexpr uint64_t Valid = uint64_t{1} << 32;
+
+  struct Entry {
+    uint64_t check;
+    uint64_t data;  // lower:8 upper:8 move:8 empties:8 valid:1
+  };
+
+  void* map_;
+  size_t map_size_;
+  Entry* entries_;
+  uint64_t mask_;
+};
+
+// File layout of a solver checkpoint: "MGSV" version:u8 board_size:u8
+// reserved:u16 reserved:u64, then a record per solved position.
+struct SolverCheckpointHeader {
+  char magic[4];
+  uint8_t version;
+  uint8_t board_size;
+  uint16_t reserved;
+  uint64_t reserved2;
+};
+static_assert(sizeof(SolverCheckpointHeader) == 16, "SolverCheckpointHeader must be packed");
+
+struct SolverCheckpointRecord {
+  uint64_t own;
+  uint64_t opp;
+  int32_t value;
+  uint32_t reserved;
+};
+static_assert(sizeof(SolverCheckpointRecord) == 24, "SolverCheckpointRecord must be packed");
+
+// Finds the final disc difference of a position under perfect play by both
+// players, for the player to move, with discs left on the board at the end
+// counting for no one. The search is a fail-soft principal variation search
+// with the table's move first and, far from the end, the moves that leave the
+// opponent the fewest replies next.
+//
+// Not every visited position is kept: a 6x6 solve visits far more positions
+// than fit on disk. Exact values are kept for the positions of the DAG down to
+// the split depth, in the checkpoint. Deeper positions with more than
+// MinTableEmpties empties only have bounds in the table, and a table entry may
+// be replaced by a later position.
+template<BoardSize N>
+class Solver {
+  static_assert(N * N <= 64, "checkpoint records hold 64-bit boards");
+
+ public:
+  using Bits = typename BitBoard<N>::Bits;
+  static constexpr int MaxScore = N * N;
+  static constexpr uint8_t CheckpointVersion = 1;
+
+  struct Result {
+    int value;
+    int move;          // the best move of the root, -1 if it must pass
+    uint64_t nodes;
+    size_t num_tasks;  // positions of the split, solved in parallel
+    size_t num_resumed;
+  };
+
+  // Called after each position of the split is solved, with the number done
+  // so far, their total, and the nodes searched so far.
+  using Progress = std::function<void(size_t done, size_t total, uint64_t nodes)>;
+
+  explicit Solver(SolverTable& table)
+      : table_(table), num_threads_(1), split_depth_(0), progress_(nullptr) {}
+
+  void SetNumThreads(const size_t n) { num_threads_ = std::max<size_t>(n, 1); }
+
+  // Plies below the root that are expanded before the positions there are
+  // solved in parallel; 0 solves the root on a single thread.
+  void SetSplitDepth(const int depth) { split_depth_ = depth; }
+
+  // Appends every solved position of the split to path, and skips those it
+  // already has, so that an interrupted run resumes where it stopped.
+  void SetCheckpoint(const std::string& path) { checkpoint_path_ = path; }
+
+  void SetProgress(Progress progress) { progress_ = std::move(progress); }
+
+  // the value of board for a window, counting the nodes searched
+  int Search(const BitBoard<N>& board, int alpha, int beta, uint64_t& nodes) const {
+    ++nodes;
+    const Bits moves = board.GetMoves();
+    if (!moves) {
+      BitBoard<N> b = board;
+      b.Pass();
+      if (!b.GetMoves()) return board.GetDifference();
+      return -Search(b, -beta, -alpha, nodes);
+    }
+
+    const int empties = board.empties();
+    const uint64_t key = board.GetKey();
+    int tt_move = -1;
+    if (empties > MinTableEmpties) {
+      int lower, upper;
+      if (table_.Probe(key, lower, upper, tt_move)) {
+        if (lower >= beta) return lower;
+        if (upper <= alpha) return upper;
+        if (lower == upper) return lower;
+        alpha = std::max(alpha, lower);
+        beta = std::min(beta, upper);
+      }
+    }
+
+    int list[N * N];
+    const int num_moves = OrderMoves(board, moves, tt_move, empties, list);
+    const int alpha0 = alpha;
+    int best = -MaxScore - 1;
+    int best_move = list[0];
+    for (int i = 0; i < num_moves; ++i) {
+      BitBoard<N> b = board;
+      b.Play(list[i]);
+      int s;
+      if (i == 0) {
+        s = -Search(b, -beta, -alpha, nodes);
+      } else {  // prove the first move best with a null window, and search again if it is not
+        s = -Search(b, -alpha - 1, -alpha, nodes);
+        if (s > alpha && s < beta) s = -Search(b, -beta, -s, nodes);
+      }
+      if (s > best) {
+        best = s;
+        best_move = list[i];
+      }
+      if (s > alpha) alpha = s;
+      if (alpha >= beta) break;
+    }
+
+    if (empties > MinTableEmpties) {
+      table_.Store(key, best > alpha0 ? best : -MaxScore, best < beta ? best : MaxScore, best_move, empties);
+    }
+    return best;
+  }
+
+  // Solves board, in parallel from the split depth on.
+  bool Solve(const BitBoard<N>& root, Result& result) {
+    std::vector<Node> nodes;
+    std::map<BitBoard<N>, size_t> index;
+    nodes.push_back(Node{root, {}, 0, false, -1});
+    index[root] = 0;
+    std::vector<size_t> tasks;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+      if (nodes[i].depth >= split_depth_) {
+        tasks.push_back(i);
+        continue;
+      }
+      Expand(nodes, index, i, tasks);
+    }
+
+    std::map<BitBoard<N>, int> solved;
+    std::ofstream checkpoint;
+    if (!checkpoint_path_.empty() && !OpenCheckpoint(solved, checkpoint)) return false;
+    result = Result{0, -1, 0, tasks.size(), 0};
+    std::vector<size_t> pending;
+    for (const auto i : tasks) {
+      const auto it = solved.find(nodes[i].board);
+      if (it == solved.end()) {
+        pending.push_back(i);
+        continue;
+      }
+      nodes[i].value = it->second;
+      nodes[i].solved = true;
+      ++result.num_resumed;
+    }
+
+    std::mutex mutex;
+    std::atomic<uint64_t> total_nodes(0);
+    size_t done = result.num_resumed;
+    util::RunWorkStealing(num_threads_, pending.size(), [&] (const size_t worker, const size_t task) {
+      Node& node = nodes[pending[task]];
+      uint64_t n = 0;
+      const int value = Search(node.board, -MaxScore, MaxScore, n);
+      total_nodes += n;
+      std::lock_guard<std::mutex> lock(mutex);
+      node.value = value;
+      node.solved = true;
+      if (checkpoint.is_open()) {
+        const SolverCheckpointRecord r{node.board.own(), node.board.opp(), value, 0};
+        checkpoint.write(reinterpret_cast<const char*>(&r), sizeof(r));
+        checkpoint.flush();
+      }
+      ++done;
+      if (progress_) progress_(done, tasks.size(), total_nodes);
+    });
+
+    // back the values up from the split to the root, children first
+    for (size_t i = nodes.size(); i-- > 0;) {
+      Node& node = nodes[i];
+      if (node.solved) continue;
+      node.value = -MaxScore - 1;
+      for (const auto& c : node.children) {
+        const int s = c.sign * nodes[c.index].value;
+        if (s > node.value) {
+          node.value = s;
+          node.move = c.move;
+        }
+      }
+      node.solved = true;
+    }
+    result.value = nodes[0].value;
+    result.move = nodes[0].move;
+    if (result.move < 0 && root.GetMoves()) {
+      // searched at the root itself: read the best move from the table
+      int lower, upper;
+      table_.Probe(root.GetKey(), lower, upper, result.move);
+    }
+    result.nodes = total_nodes;
+    return static_cast<bool>(checkpoint) || !checkpoint.is_open();
+  }
+
+ private:
+  static constexpr int MinTableEmpties = 3;   // closer to the end, a search is cheaper than the table
+  static constexpr int MinOrderEmpties = 7;   // closer to the end, moves are taken as they come
+
+  struct Child {
+    size_t index;
+    int sign;  // of its value for the parent, + if the other player had to pass
+    int move;
+  };
+
+  struct Node {
+    BitBoard<N> board;
+    std::vector<Child> children;
+    int depth;
+    bool solved;  // finished games and the positions of the split once searched
+    int move;
+    int value;
+
+    Node(const BitBoard<N>& b, std::vector<Child> c, const int d, const bool s, const int m)
+        : board(b), children(std::move(c)), depth(d), solved(s), move(m), value(0) {}
+  };
+
+  // Adds the positions one move after nodes[i], merging transpositions.
+  void Expand(std::vector<Node>& nodes, std::map<BitBoard<N>, size_t>& index, const size_t i,
+              std::vector<size_t>& tasks) const {
+    const BitBoard<N> board = nodes[i].board;
+    Bits moves = board.GetMoves();
+    if (!moves) {  // only at the root: the player to move passes
+      BitBoard<N> b = board;
+      b.Pass();
+      moves = b.GetMoves();
+      if (!moves) {
+        nodes[i].value = board.GetDifference();
+        nodes[i].solved = true;
+        return;
+      }
+      // Add may reallocate nodes, so it runs before nodes[i] is used
+      const size_t child = Add(nodes, index, b, nodes[i].depth);
+      nodes[i].children.push_back(Child{child, -1, -1});
+      return;
+    }
+    for (; moves; moves &= moves - 1) {
+      const int m = FirstBit(moves);
+      BitBoard<N> b = board;
+      b.Play(m);
+      int sign = -1;
+      if (!b.GetMoves()) {
+        BitBoard<N> c = b;
+        c.Pass();
+        if (c.GetMoves()) {
+          b = c;
+          sign = 1;
+        }
+      }
+      const size_t child = Add(nodes, index, b, nodes[i].depth + 1);
+      nodes[i].children.push_back(Child{child, sign, m});
+    }
+  }
+
+  static size_t Add(std::vector<Node>& nodes, std::map<BitBoard<N>, size_t>& index,
+                    const BitBoard<N>& b, const int depth) {
+    const auto it = index.find(b);
+    if (it != index.end()) return it->second;
+    index[b] = nodes.size();
+    const bool finished = !b.GetMoves();  // passes were resolved by the caller
+    nodes.push_back(Node(b, {}, depth, finished, -1));
+    if (finished) nodes.back().value = b.GetDifference();
+    return nodes.size() - 1;
+  }
+
+  int OrderMoves(const BitBoard<N>& board, Bits moves, const int tt_move, const int empties,
+                 int* list) const {
+    int n = 0;
+    if (tt_move >= 0 && (moves >> tt_move & 1)) {
+      list[n++] = tt_move;
+      moves &= ~(Bits{1} << tt_move);
+    }
+    const int first = n;
+    int replies[N * N];
+    for (; moves; moves &= moves - 1) {
+      const int m = FirstBit(moves);
+      if (empties >= MinOrderEmpties) {
+        BitBoard<N> b = board;
+        b.Play(m);
+        replies[n] = PopCount(b.GetMoves());
+      }
+      list[n++] = m;
+    }
+    if (empties >= MinOrderEmpties) {
+      // insertion sort by the opponent's mobility, fewest first
+      for (int i = first + 1; i < n; ++i) {
+        const int m = list[i];
+        const int r = replies[i];
+        int j = i;
+        for (; j > first && replies[j - 1] > r; --j) {
+          list[j] = list[j - 1];
+          replies[j] = replies[j - 1];
+        }
+        list[j] = m;
+        replies[j] = r;
+      }
+    }
+    return n;
+  }
+
+  bool OpenCheckpoint(std::map<BitBoard<N>, int>& solved, std::ofstream& out) const {
+    const char* path = checkpoint_path_.c_str();
+    std::ifstream in(path, std::ios::binary);
+    SolverCheckpointHeader h;
+    if (in.read(reinterpret_cast<char*>(&h), sizeof(h))) {
+      if (std::memcmp(h.magic, "MGSV", 4) != 0 || h.version != CheckpointVersion || h.board_size != N) {
+        return false;
+      }
+      SolverCheckpointRecord r;
+      size_t k = 0;
+      for (; in.read(reinterpret_cast<char*>(&r), sizeof(r)); ++k) solved[BitBoard<N>(r.own, r.opp)] = r.value;
+      in.close();
+      // drops a record cut short by a kill, so that the appended ones stay aligned
+      if (::truncate(path, sizeof(h) + k * sizeof(r)) != 0) return false;
+      out.open(path, std::ios::binary | std::ios::app);
+      return static_cast<bool>(out);
+    }
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, "MGSV", 4);
+    h.version = CheckpointVersion;
+    h.board_size = N;
+    out.open(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    return static_cast<bool>(out);
+  }
+
+  SolverTable& table_;
+  size_t num_threads_;
+  int split_depth_;
+  std::string checkpoint_path_;
+  Progress progress_;
+};
+
+}  // namespace othello
@@ -0,0 +1,196 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include "perf.hpp"
+
+namespace player {
+
+// Counters collected by a search player, either for a single move or summed
+// over all moves played so far.
+struct SearchStats {
+  static constexpr size_t HistogramBuckets = 64;
+  static constexpr size_t HistogramWidth = 4;  // playout lengths per bucket
+  using Histogram = std::array<size_t, HistogramBuckets>;
+  using Counters = util::PerfCounters::Values;
+
+  size_t moves;
+  size_t iterations;
+  size_t playouts;
+  size_t nodes;
+  size_t memory_bytes;  // reserved by the search
+  size_t used_bytes;    // used by the tree, at its largest
+  size_t allocations;   // chunks allocated for the tree; 0 once warm
+  size_t max_depth;
+  size_t total_depth;  // sum of the depths of the expanded nodes
+  double value;        // estimated value of the chosen move, for the latest move
+  size_t solved;       // moves whose outcome the search proved
+  // wall time, and its split by phase if phase timing was enabled
+  std::chrono::nanoseconds time;
+  std::chrono::nanoseconds select_time;
+  std::chrono::nanoseconds expand_time;
+  std::chrono::nanoseconds simulate_time;
+  std::chrono::nanoseconds backprop_time;
+  // hardware counters by phase, if perf counters were enabled and available
+  Counters select_counters;
+  Counters expand_counters;
+  Counters simulate_counters;
+  Counters backprop_counters;
+  // number of playouts by length in moves; the last bucket also counts longer ones
+  Histogram playout_lengths;
+
+  SearchStats() { Clear(); }
+
+  void Clear() {
+    moves = 0;
+    iterations = 0;
+    playouts = 0;
+    nodes = 0;
+    memory_bytes = 0;
+    used_bytes = 0;
+    allocations = 0;
+    max_depth = 0;
+    total_depth = 0;
+    value = 0;
+    solved = 0;
+    time = select_time = expand_time = simulate_time = backprop_time = std::chrono::nanoseconds::zero();
+    select_counters.fill(0);
+    expand_counters.fill(0);
+    simulate_counters.fill(0);
+    backprop_counters.fill(0);
+    playout_lengths.fill(0);
+  }
+
+  double MeanDepth() const { return iterations ? static_cast<double>(total_depth) / iterations : 0; }
+
+  void AddDepth(const size_t depth) {
+    total_depth += depth;
+    max_depth = std::max(max_depth, depth);
+  }
+
+  void AddPlayoutLength(const size_t length) {
+    ++playout_lengths[std::min(length / HistogramWidth, HistogramBuckets - 1)];
+  }
+
+  void Merge(const SearchStats& o) {
+    moves += o.moves;
+    iterations += o.iterations;
+    playouts += o.playouts;
+    nodes += o.nodes;
+    memory_bytes = std::max(memory_bytes, o.memory_bytes);
+    used_bytes = std::max(used_bytes, o.used_bytes);
+    allocations += o.allocations;
+    max_depth = std::max(max_depth, o.max_depth);
+    total_depth += o.total_depth;
+    value = o.value;
+    solved += o.solved;
+    time += o.time;
+    select_time += o.select_time;
+    expand_time += o.expand_time;
+    simulate_time += o.simulate_time;
+    backprop_time += o.backprop_time;
+    for (size_t i = 0; i < select_counters.size(); ++i) {
+      select_counters[i] += o.select_counters[i];
+      expand_counters[i] += o.expand_counters[i];
+      simulate_counters[i] += o.simulate_counters[i];
+      backprop_counters[i] += o.backprop_counters[i];
+    }
+    for (size_t i = 0; i < HistogramBuckets; ++i) playout_lengths[i] += o.playout_lengths[i];
+  }
+
+  bool HasCounters() const {
+    for (size_t i = 0; i < select_counters.size(); ++i) {
+      if (select_counters[i] || expand_counters[i] || simulate_counters[i] || backprop_counters[i]) return true;
+    }
+    return false;
+  }
+
+  // Writes the stats as a single line of JSON, without the trailing newline.
+  // The counters are only written if any was counted.
+  void WriteJson(std::ostream& os) const {
+    auto us = [] (const std::chrono::nanoseconds t) {
+      return std::chrono::duration_cast<std::chrono::microseconds>(t).count();
+    };
+    os << "{\"moves\":" << moves
+       << ",\"iterations\":" << iterations
+       << ",\"playouts\":" << playouts
+       << ",\"nodes\":" << nodes
+       << ",\"memory_bytes\":" << memory_bytes
+       << ",\"used_bytes\":" << used_bytes
+       << ",\"allocations\":" << allocations
+       << ",\"max_depth\":" << max_depth
+       << ",\"mean_depth\":" << MeanDepth()
+       << ",\"value\":" << value
+       << ",\"solved\":" << solved
+       << ",\"time_us\":" << us(time)
+       << ",\"select_us\":" << us(select_time)
+       << ",\"expand_us\":" << us(expand_time)
+       << ",\"simulate_us\":" << us(simulate_time)
+       << ",\"backprop_us\":" << us(backprop_time)
+       << ",\"playout_length_bucket\":" << HistogramWidth
+       << ",\"playout_lengths\":[";
+    size_t n = HistogramBuckets;
+    while (n > 1 && playout_lengths[n - 1] == 0) --n;  // trim empty tail
+    for (size_t i = 0; i < n; ++i) {
+      os << (i ? "," : "") << playout_lengths[i];
+    }
+    os << "]";
+    if (HasCounters()) {
+      const char* phases[] = {"select", "expand", "simulate", "backprop"};
+      const Counters* counters[] = {&select_counters, &expand_counters, &simulate_counters, &backprop_counters};
+      os << ",\"counters\":{";
+      for (int p = 0; p < 4; ++p) {
+        os << (p ? "," : "") << "\"" << phases[p] << "\":{";
+        for (int e = 0; e < util::PerfCounters::NumEvents; ++e) {
+          os << (e ? "," : "") << "\"" << util::PerfCounters::GetName(static_cast<util::PerfCounters::Event>(e))
+             << "\":" << (*counters[p])[e];
+        }
+        os << "}";
+      }
+      os << "}";
+    }
+    os << "}";
+  }
+};
+
+// Measures the time spent in one search phase when enabled, and the
+// hardware counts when given open counters; nothing otherwise.
+class PhaseTimer {
+ public:
+  using Clock = std::chrono::steady_clock;
+  using Counters = util::PerfCounters::Values;
+
+  explicit PhaseTimer(const bool enabled, const util::PerfCounters* counters = nullptr)
+      : enabled_(enabled), counters_(counters && counters->ok() ? counters : nullptr) {
+    if (enabled_) last_ = Clock::now();
+    if (counters_) counters_->Read(last_counts_);
+  }
+
+  // Adds the time since the previous call (or construction) to t.
+  void Lap(std::chrono::nanoseconds& t) {
+    if (!enabled_) return;
+    const auto now = Clock::now();
+    t += now - last_;
+    last_ = now;
+  }
+
+  // Also adds the counts since the previous call to c.
+  void Lap(std::chrono::nanoseconds& t, Counters& c) {
+    Lap(t);
+    if (!counters_) return;
+    Counters counts;
+    counters_->Read(counts);
+    util::AddDifference(c, counts, last_counts_);
+    last_counts_ = counts;
+  }
+
+ private:
+  bool enabled_;
+  const util::PerfCounters* counters_;
+  Clock::time_point last_;
+  Counters last_counts_;
+};
+
+}  // namespace player
@@ -0,0 +1,78 @@
+#undef NDEBUG
+#include <cassert>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "gomoku.hpp"
+
+template<gomoku::BoardSize N>
+bool IsSameBoard(const gomoku::Board<N>& a, const gomoku::Board<N>& b) {
+  return a.array().bytes() == b.array().bytes() && a.current_player() == b.current_player() &&
+         a.winner() == b.winner() && a.GetLegalMoves() == b.GetLegalMoves();
+}
+
+// Plays random games with Next(m, undo), checking that Undo restores the
+// board exactly after every move, winning moves and full boards included,
+// and that undoing the whole game leads back to the empty board.
+template<gomoku::BoardSize N>
+void TestNextUndo(const int num_games) {
+  std::mt19937 rng(N);
+  size_t num_draws = 0;
+  for (int g = 0; g < num_games; ++g) {
+    gomoku::Board<N> board;
+    std::vector<typename gomoku::Board<N>::UndoInfo> undos;
+    while (!board.IsFinished()) {
+      const auto moves = board.GetLegalMoves();
+      const auto m = moves[std::uniform_int_distribution<size_t>(0, moves.size() - 1)(rng)];
+      const gomoku::Board<N> before = board;
+      typename gomoku::Board<N>::UndoInfo undo;
+      board.Next(m, undo);
+      gomoku::Board<N> after = board;
+      after.Undo(undo);
+      assert(IsSameBoard(after, before));
+      undos.push_back(undo);
+    }
+    num_draws += board.IsDraw();
+    for (auto it = undos.rbegin(); it != undos.rend(); ++it) board.Undo(*it);
+    assert(IsSameBoard(board, gomoku::Board<N>()));
+  }
+  // small boards fill up without a line of five now and then
+  assert(N > gomoku::K || num_draws > 0);
+}
+
+// Plays random games, checking that MayEndNext holds wherever some legal
+// move ends the game, and that it does not hold everywhere.
+template<gomoku::BoardSize N>
+void TestMayEndNext(const int num_games) {
+  std::mt19937 rng(N);
+  size_t num_positions = 0;
+  size_t num_may_end = 0;
+  for (int g = 0; g < num_games; ++g) {
+    gomoku::Board<N> board;
+    while (!board.IsFinished()) {
+      const auto moves = board.GetLegalMoves();
+      bool ends = false;
+      typename gomoku::Board<N>::UndoInfo undo;
+      for (const auto m : moves) {
+        board.Next(m, undo);
+        ends = ends || board.IsFinished();
+        board.Undo(undo);
+      }
+      assert(!ends || board.MayEndNext());
+      ++num_positions;
+      num_may_end += board.MayEndNext();
+      board.Next(moves[std::uniform_int_distribution<size_t>(0, moves.size() - 1)(rng)]);
+    }
+  }
+  assert(num_may_end < num_positions);
+}
+
+int main() {
+  TestNextUndo<gomoku::K>(2000);
+  TestNextUndo<9>(500);
+  TestNextUndo<15>(200);
+  TestMayEndNext<gomoku::K>(2000);
+  TestMayEndNext<9>(500);
+  TestMayEndNext<15>(200);
+  std::cout << "OK" << std::endl;
+}
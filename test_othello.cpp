@@ -0,0 +1,171 @@
+#undef NDEBUG
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "bitboard.hpp"
+#include "othello.hpp"
+#include "player.hpp"
+
+// Plays random games on Board<N> and BitBoard<N> side by side and checks
+// that they agree after every move: the discs, the legal moves, the passes
+// and the final disc difference.
+template<othello::BoardSize N>
+void TestBitBoardMatchesBoard(const int num_games) {
+  using Bits = typename othello::BitBoard<N>::Bits;
+  std::mt19937 rng(N);
+  for (int g = 0; g < num_games; ++g) {
+    othello::Board<N> board;
+    auto bits = othello::BitBoard<N>::GetStartingPosition();
+    othello::Player p = othello::DARK;  // the player to move on bits
+    while (!board.IsFinished()) {
+      const auto moves = board.GetLegalMoves();
+      Bits expected = 0;
+      for (const auto m : moves) expected |= Bits{1} << m;
+      assert(bits.GetMoves() == expected);
+      assert(othello::PopCount(expected) == static_cast<int>(moves.size()));
+      const auto m = moves[std::uniform_int_distribution<size_t>(0, moves.size() - 1)(rng)];
+      board.Next(m);
+      bits.Play(m);
+      p = othello::GetOppositePlayer(p);
+      if (board.current_player() != p) {
+        // a pass, or the end of the game
+        assert(bits.GetMoves() == 0);
+        bits.Pass();
+        p = othello::GetOppositePlayer(p);
+      }
+      if (board.IsFinished()) assert(bits.GetMoves() == 0);
+      // FromBoard puts dark first once the game is finished
+      const bool flip = board.IsFinished() && p != othello::DARK;
+      if (flip) bits.Pass();
+      assert(bits == othello::BitBoard<N>::FromBoard(board));
+      if (flip) bits.Pass();
+    }
+    const int difference = p == othello::DARK ? bits.GetDifference() : -bits.GetDifference();
+    assert(difference == board.GetDifference(othello::DARK));
+  }
+}
+
+template<othello::BoardSize N>
+bool IsSameBoard(const othello::Board<N>& a, const othello::Board<N>& b) {
+  return a.array().bytes() == b.array().bytes() && a.current_player() == b.current_player() &&
+         a.winner() == b.winner() && a.GetDifference(othello::DARK) == b.GetDifference(othello::DARK);
+}
+
+// Plays random games with Next(m, undo), checking that Undo restores the
+// board exactly after every move, passes and game-ending moves included, and
+// that undoing the whole game leads back to the starting position.
+template<othello::BoardSize N>
+void TestNextUndo(const int num_games) {
+  std::mt19937 rng(N);
+  for (int g = 0; g < num_games; ++g) {
+    othello::Board<N> board;
+    std::vector<typename othello::Board<N>::UndoInfo> undos;
+    while (!board.IsFinished()) {
+      const auto moves = board.GetLegalMoves();
+      const auto m = moves[std::uniform_int_distribution<size_t>(0, moves.size() - 1)(rng)];
+      const othello::Board<N> before = board;
+      typename othello::Board<N>::UndoInfo undo;
+      board.Next(m, undo);
+      othello::Board<N> after = board;
+      after.Undo(undo);
+      assert(IsSameBoard(after, before));
+      undos.push_back(undo);
+    }
+    for (auto it = undos.rbegin(); it != undos.rend(); ++it) board.Undo(*it);
+    assert(IsSameBoard(board, othello::Board<N>()));
+  }
+}
+
+// Saves a search tree, resumes from it in another engine a move later, and
+// rejects a damaged file.
+void TestTreeSnapshot() {
+  using GT = othello::GameTraits<6>;
+  using MCTS = player::GenericMCTS<GT>;
+  const char* path = "/tmp/test_othello_tree.bin";
+  std::mt19937 rng1(1);
+  std::mt19937 rng2(2);
+  MCTS mcts1(rng1, std::chrono::milliseconds(0));
+  MCTS mcts2(rng2, std::chrono::milliseconds(0));
+  mcts1.SetMaxIterations(2000);
+  mcts2.SetMaxIterations(2000);
+  GT::Board board;
+  GT::History history;
+  const auto m = mcts1.GetNextMove(board, history);
+  assert(mcts1.SaveTree(path));
+  assert(mcts2.LoadTree(path));
+  assert(mcts2.root_visits() == 2000);
+
+  // the reply continues from the subtree of the move played
+  history.emplace_back(board.current_player(), m);
+  board.Next(m);
+  mcts2.GetNextMove(board, history);
+  assert(mcts2.root_visits() > 2000);
+
+  // a board that the history does not lead to starts afresh
+  assert(mcts2.LoadTree(path));
+  mcts2.GetNextMove(board, GT::History());
+  assert(mcts2.root_visits() == 2000);
+
+  // damaged files are rejected: a move off the board, one that would alias
+  // a legal move once narrowed, an illegal move, a move repeated among
+  // siblings, a node count that overflows the size check, and a truncated
+  // file
+  assert(mcts1.SaveTree(path));
+  std::ifstream in(path, std::ios::binary);
+  const std::vector<char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  const auto* header = reinterpret_cast<const player::TreeFileHeader*>(bytes.data());
+  const size_t nodes = sizeof(player::TreeFileHeader) + 8 * ((header->num_moves + 3) / 4);
+  const size_t num_nodes = (bytes.size() - nodes) / sizeof(player::TreeFileNode);
+  auto corrupt = [&] (const size_t node, const int16_t move) {
+    std::vector<char> b = bytes;
+    auto* records = reinterpret_cast<player::TreeFileNode*>(&b[nodes]);
+    records[node].move = move;
+    std::ofstream(path, std::ios::binary).write(b.data(), b.size());
+    return mcts2.LoadTree(path);
+  };
+  auto* records = reinterpret_cast<const player::TreeFileNode*>(&bytes[nodes]);
+  assert(records[0].num_children >= 2 && num_nodes > records[1].first_child);
+  assert(!corrupt(1, 36));
+  assert(!corrupt(1, -1));
+  assert(!corrupt(1, records[1].move + 256));
+  assert(!corrupt(1, 0));  // a corner, which is never legal on the first move
+  assert(!corrupt(1, records[2].move));
+  // a deeper node, whose board is only reached by replay
+  assert(!corrupt(records[1].first_child, 0));
+  assert(corrupt(1, records[1].move));
+  std::vector<char> b = bytes;
+  reinterpret_cast<player::TreeFileHeader*>(b.data())->num_nodes = num_nodes + (uint64_t{1} << 59);
+  std::ofstream(path, std::ios::binary).write(b.data(), b.size());
+  assert(!mcts2.LoadTree(path));
+  std::ofstream(path, std::ios::binary).write(bytes.data(), bytes.size() - 1);
+  assert(!mcts2.LoadTree(path));
+  assert(mcts2.root_visits() == 0);
+
+  // and so is a root move that would alias the one played once narrowed
+  mcts2.GetNextMove(board, history);
+  assert(mcts2.SaveTree(path));
+  std::ifstream in2(path, std::ios::binary);
+  b.assign(std::istreambuf_iterator<char>(in2), std::istreambuf_iterator<char>());
+  auto* moves = reinterpret_cast<int16_t*>(&b[sizeof(player::TreeFileHeader)]);
+  assert(reinterpret_cast<const player::TreeFileHeader*>(b.data())->num_moves == 1 && moves[0] == m);
+  moves[0] += 256;
+  std::ofstream(path, std::ios::binary).write(b.data(), b.size());
+  assert(!mcts2.LoadTree(path));
+  std::remove(path);
+}
+
+int main() {
+  TestBitBoardMatchesBoard<4>(2000);
+  TestBitBoardMatchesBoard<6>(1000);
+  TestBitBoardMatchesBoard<8>(500);
+  TestBitBoardMatchesBoard<10>(500);
+  TestNextUndo<4>(2000);
+  TestNextUndo<6>(500);
+  TestNextUndo<8>(200);
+  TestNextUndo<10>(100);
+  TestTreeSnapshot();
+  std::cout << "OK" << std::endl;
+}
@@ -1,6 +1,9 @@
 #undef NDEBUG
 #include <cassert>
 #include <iostream>
+#include <limits>
+#include "numa.hpp"
+#include "params.hpp"
 #include "util.hpp"
 
 void TestBitPack2() {
@@ -72,8 +75,70 @@ void TestBitPack3() {
   assert(bitpack[4] == 4);
 }
 
+void TestArenaReusesChunks() {
+  util::Arena<int, 8> arena;
+  int* a = arena.Allocate(5);
+  int* b = arena.Allocate(4);  // does not fit in the first chunk
+  assert(b != a + 5);
+  assert(arena.size() == 12);
+  assert(arena.num_allocations() == 2);
+  arena.clear();
+  assert(arena.empty());
+  assert(arena.Allocate(5) == a);
+  assert(arena.Allocate(4) == b);
+  assert(arena.num_allocations() == 2);
+  assert(arena.high_water() == 12);
+  assert(arena.capacity() == 16);
+}
+
+void TestArgMaxMulAdd() {
+  const float inf = std::numeric_limits<float>::infinity();
+  // padded to 8 lanes
+  const float a[] = {.5f, .2f, .9f, .1f, .3f, .9f, -inf, -inf};
+  const float b[] = {1, 1, .1f, 1, 1, .1f, 0, 0};
+  assert(util::ArgMaxMulAdd(a, b, 0, 6) == 2);  // ties go to the first index
+  assert(util::ArgMaxMulAdd(a, b, 1, 6) == 0);
+  assert(util::ArgMaxMulAdd(a, b, 10, 6) == 0);
+  assert(util::ArgMaxMulAdd(a + 3, b + 3, 1, 3) == 1);
+  const float c[] = {-inf, -inf, -inf, -inf};
+  const float d[] = {0, 0, 0, 0};
+  assert(util::ArgMaxMulAdd(c, d, 1, 1) == 0);
+}
+
+void TestTopology() {
+  const std::vector<int> cpus = {0, 1, 2, 3, 8, 10, 11};
+  assert(util::Topology::ParseCpuList("0-3,8,10-11") == cpus);
+  assert(util::Topology::ParseCpuList("").empty());
+  // falls back to one node on machines without NUMA
+  const auto t = util::Topology::Read();
+  assert(t.num_nodes() >= 1 && !t.nodes()[0].cpus.empty());
+  assert(t.node_mask() != 0);
+  assert(t.GetNodeIndex(t.num_nodes()) == 0);
+}
+
+// Budgets are digits and a unit, within the caps; signs and overflows are
+// rejected rather than wrapped.
+void TestParseBudget() {
+  bool by_time;
+  size_t budget;
+  assert(player::ParamTable::ParseBudget("1000it", by_time, budget) && !by_time && budget == 1000);
+  assert(player::ParamTable::ParseBudget("100ms", by_time, budget) && by_time && budget == 100);
+  assert(player::ParamTable::ParseBudget("60000ms", by_time, budget));
+  assert(!player::ParamTable::ParseBudget("60001ms", by_time, budget));
+  assert(!player::ParamTable::ParseBudget("10000001it", by_time, budget));
+  assert(!player::ParamTable::ParseBudget("-1it", by_time, budget));
+  assert(!player::ParamTable::ParseBudget("+1it", by_time, budget));
+  assert(!player::ParamTable::ParseBudget("99999999999999999999999it", by_time, budget));
+  assert(!player::ParamTable::ParseBudget("1000", by_time, budget));
+  assert(!player::ParamTable::ParseBudget("", by_time, budget));
+}
+
 int main() {
   TestBitPack2();
   TestBitPack3();
+  TestArenaReusesChunks();
+  TestArgMaxMulAdd();
+  TestTopology();
+  TestParseBudget();
   std::cout << "OK" << std::endl;
 }
@@ -0,0 +1,153 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "othello.hpp"
+#include "pattern.hpp"
+#include "record.hpp"
+
+// Trains the weights of othello::PatternEvaluator on game records (see bench
+// --record). Every position of every game is a sample whose target is the
+// final score of the game for the player to move, and the weights are fit by
+// stochastic gradient descent on the squared error. Every k-th game is held
+// out to measure how well the weights generalize.
+
+namespace {
+
+constexpr const uint8_t N = 8;
+using GT = othello::GameTraits<N>;
+using Evaluator = othello::PatternEvaluator<N>;
+
+struct Options {
+  std::string records;  // comma separated record files
+  std::string out = "patterns.bin";
+  size_t epochs = 20;
+  double rate = .002;
+  size_t holdout = 10;  // every k-th game is held out; 0 trains on all
+  size_t seed = 1;
+};
+
+struct Sample {
+  std::vector<uint32_t> features;
+  float target;
+};
+
+double Predict(const std::vector<float>& w, const Sample& s) {
+  double sum = 0;
+  for (const auto i : s.features) sum += w[i];
+  return std::max(-1.0, std::min(1.0, sum));
+}
+
+// root mean square error in discs
+double GetError(const std::vector<float>& w, const std::vector<Sample>& samples) {
+  double sum = 0;
+  for (const auto& s : samples) {
+    const double e = Predict(w, s) - s.target;
+    sum += e * e;
+  }
+  return samples.empty() ? 0 : std::sqrt(sum / samples.size()) * N * N;
+}
+
+bool ParseOption(Options& opt, const char* arg) {
+  const char* eq = std::strchr(arg, '=');
+  if (std::strncmp(arg, "--", 2) != 0 || !eq) return false;
+  const std::string key(arg + 2, eq);
+  const char* value = eq + 1;
+  if (key == "records") opt.records = value;
+  else if (key == "out") opt.out = value;
+  else if (key == "epochs") opt.epochs = std::strtoul(value, nullptr, 10);
+  else if (key == "rate") opt.rate = std::strtod(value, nullptr);
+  else if (key == "holdout") opt.holdout = std::strtoul(value, nullptr, 10);
+  else if (key == "seed") opt.seed = std::strtoul(value, nullptr, 10);
+  else return false;
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options opt;
+  for (int i = 1; i < argc; ++i) {
+    if (!ParseOption(opt, argv[i])) {
+      std::cerr << "usage: " << argv[0]
+                << " [--records=FILE,...] [--out=FILE] [--epochs=N] [--rate=X]"
+                << " [--holdout=K] [--seed=N]" << std::endl;
+      return 1;
+    }
+  }
+  const auto start_time = std::chrono::high_resolution_clock::now();
+
+  std::vector<Sample> train;
+  std::vector<Sample> test;
+  size_t games = 0;
+  std::istringstream paths(opt.records);
+  std::string path;
+  while (std::getline(paths, path, ',')) {
+    if (path.empty()) continue;
+    util::MappedFile file(path.c_str());
+    record::Reader<GT> reader(file.data(), file.size());
+    if (!file.ok() || !reader.ok()) {
+      std::cerr << "Cannot read 8x8 othello records from " << path << std::endl;
+      return 1;
+    }
+    record::Record<GT> r;
+    std::vector<othello::Board<N>> positions;
+    while (reader.Next(r)) {
+      positions.clear();
+      othello::Board<N> b;
+      record::Replay(r, b, [&positions] (const othello::Board<N>& board, const othello::Move m) {
+        positions.push_back(board);
+      });
+      if (!b.IsFinished()) continue;  // ended by an illegal move
+      auto& samples = opt.holdout && games % opt.holdout == opt.holdout - 1 ? test : train;
+      for (const auto& board : positions) {
+        Sample s;
+        s.target = GT::GetScore(b, board.current_player());
+        Evaluator::ForEachFeature(board, [&s] (const size_t i) { s.features.push_back(i); });
+        samples.push_back(std::move(s));
+      }
+      ++games;
+    }
+  }
+  std::cout << "Games = " << games << std::endl
+            << "Positions = " << train.size() << " + " << test.size() << " held out" << std::endl;
+  if (train.empty()) {
+    std::cerr << "No positions to train on" << std::endl;
+    return 1;
+  }
+
+  Evaluator evaluator;
+  auto& w = evaluator.weights();
+  std::mt19937 rng(opt.seed);
+  std::vector<size_t> order(train.size());
+  std::iota(order.begin(), order.end(), 0);
+  for (size_t epoch = 1; epoch <= opt.epochs; ++epoch) {
+    std::shuffle(order.begin(), order.end(), rng);
+    for (const auto i : order) {
+      const auto& s = train[i];
+      const float step = opt.rate * (s.target - Predict(w, s));
+      for (const auto f : s.features) w[f] += step;
+    }
+    std::cout << "Epoch " << epoch << ": error = " << GetError(w, train) << " discs";
+    if (!test.empty()) std::cout << ", held out = " << GetError(w, test) << " discs";
+    std::cout << std::endl;
+  }
+
+  if (!evaluator.Save(opt.out.c_str())) {
+    std::cerr << "Cannot write " << opt.out << std::endl;
+    return 1;
+  }
+  const auto end_time = std::chrono::high_resolution_clock::now();
+  std::cout << "Weights = " << w.size() << std::endl
+            << "Time = " << std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count() / 1000.0
+            << " sec" << std::endl;
+  return 0;
+}
@@ -0,0 +1,193 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "dispatch.hpp"
+#include "display.hpp"
+#include "params.hpp"
+#include "player.hpp"
+#include "worker_pool.hpp"
+
+// Tunes the search constants of GenericMCTS for one game, board size and
+// budget with SPSA, and writes them to a parameter table that the players
+// load with --params. Each step perturbs all constants at once in a random
+// direction, plays the two perturbed settings against each other, and moves
+// the constants along the direction that scored better. The games of a step
+// are played in parallel, each seeded by (seed, step, game), so with an
+// iteration budget a run gives the same constants for any number of threads.
+
+namespace {
+
+struct Options {
+  std::string game = "othello";
+  int size = 8;
+  std::string budget = "1000it";
+  size_t steps = 100;
+  size_t pairs = 8;  // games per step, each played twice with the colors swapped
+  size_t threads = std::thread::hardware_concurrency();
+  size_t seed = 1;
+  player::SearchParams start = {.4, 0};
+  std::string table;  // updated in place if it exists
+};
+
+bool ParseOption(Options& opt, const char* arg) {
+  const char* eq = std::strchr(arg, '=');
+  if (std::strncmp(arg, "--", 2) != 0 || !eq) return false;
+  const std::string key(arg + 2, eq);
+  const char* value = eq + 1;
+  bool by_time;
+  size_t budget;
+  if (key == "game") return dispatch::ParseGame(value, opt.game, opt.size);
+  if (key == "budget") {
+    opt.budget = value;
+    return player::ParamTable::ParseBudget(opt.budget, by_time, budget);
+  }
+  if (key == "steps") opt.steps = std::strtoul(value, nullptr, 10);
+  else if (key == "pairs") opt.pairs = std::strtoul(value, nullptr, 10);
+  else if (key == "threads") opt.threads = std::strtoul(value, nullptr, 10);
+  else if (key == "seed") opt.seed = std::strtoul(value, nullptr, 10);
+  else if (key == "bias") opt.start.bias = std::strtod(value, nullptr);
+  else if (key == "margin") opt.start.margin_weight = std::strtod(value, nullptr);
+  else if (key == "table") opt.table = value;
+  else return false;
+  return true;
+}
+
+// The constants are tuned on [0, 1] each, mapped linearly to these ranges.
+constexpr int NumParams = 2;
+constexpr double Low[NumParams] = {.05, 0};
+constexpr double High[NumParams] = {2, 1};
+
+void ToUnit(const player::SearchParams& p, double x[NumParams]) {
+  x[0] = (p.bias - Low[0]) / (High[0] - Low[0]);
+  x[1] = (p.margin_weight - Low[1]) / (High[1] - Low[1]);
+}
+
+player::SearchParams FromUnit(const double x[NumParams]) {
+  double y[NumParams];
+  for (int i = 0; i < NumParams; ++i) y[i] = Low[i] + std::min(std::max(x[i], 0.0), 1.0) * (High[i] - Low[i]);
+  return player::SearchParams{y[0], y[1]};
+}
+
+struct Tune {
+  const Options& opt;
+  bool by_time;   // of the budget, parsed by Run
+  size_t budget;
+
+  // Plays game i of a step between the two settings and returns 1 if the
+  // first one won, -1 if the second one did and 0 for a draw.
+  template<class GT>
+  int PlayGame(const player::SearchParams params[2], const size_t step, const size_t i) {
+    using MCTS = player::GenericMCTS<GT>;
+    std::seed_seq seq1{opt.seed, step, i, size_t{1}};
+    std::seed_seq seq2{opt.seed, step, i, size_t{2}};
+    std::mt19937 rng1(seq1);
+    std::mt19937 rng2(seq2);
+    MCTS mcts1(rng1, std::chrono::milliseconds(by_time ? budget : 0));
+    MCTS mcts2(rng2, std::chrono::milliseconds(by_time ? budget : 0));
+    // the first setting plays first in even games
+    const bool swap = i % 2 == 1;
+    player::ApplyParams(params[swap ? 1 : 0], mcts1);
+    player::ApplyParams(params[swap ? 0 : 1], mcts2);
+    mcts1.SetMaxIterations(by_time ? 0 : util::at_least_1(budget));
+    mcts2.SetMaxIterations(by_time ? 0 : util::at_least_1(budget));
+    ui::NullDisplay display;
+    typename GT::Board b;
+    typename GT::GameResult result;
+    GT::Play(b, mcts1, mcts2, result, display);
+    if (!result.winner) return 0;
+    const bool first_won = result.winner == typename GT::Board().current_player();
+    return first_won != swap ? 1 : -1;
+  }
+
+  template<class GT>
+  void Run() {
+    // validated by ParseOption
+    if (!player::ParamTable::ParseBudget(opt.budget, by_time, budget)) return;
+    const size_t num_games = 2 * util::at_least_1(opt.pairs);
+    const size_t steps = util::at_least_1(opt.steps);
+    // the usual SPSA gains, scaled so that the first step moves the
+    // constants by about 5% of their ranges at a score of 1
+    const double alpha = .602;
+    const double gamma = .101;
+    const double A = steps / 10.0;
+    const double a = .05 * std::pow(A + 1, alpha);
+    const double c = .1;
+
+    double x[NumParams];
+    ToUnit(opt.start, x);
+    std::mt19937 rng(opt.seed);
+    std::vector<int> scores(num_games);
+    const auto start_time = std::chrono::steady_clock::now();
+    for (size_t k = 0; k < steps; ++k) {
+      const double ak = a / std::pow(k + 1 + A, alpha);
+      const double ck = c / std::pow(k + 1, gamma);
+      double delta[NumParams];
+      double plus[NumParams];
+      double minus[NumParams];
+      for (int i = 0; i < NumParams; ++i) {
+        delta[i] = std::bernoulli_distribution(.5)(rng) ? 1 : -1;
+        plus[i] = x[i] + ck * delta[i];
+        minus[i] = x[i] - ck * delta[i];
+      }
+      const player::SearchParams params[2] = {FromUnit(plus), FromUnit(minus)};
+      util::RunWorkStealing(util::at_least_1(opt.threads), num_games,
+                            [this, &params, &scores, k] (size_t, const size_t i) {
+        scores[i] = PlayGame<GT>(params, k, i);
+      });
+      int score = 0;
+      for (const int s : scores) score += s;
+      const double r = static_cast<double>(score) / num_games;
+      for (int i = 0; i < NumParams; ++i) x[i] = std::min(std::max(x[i] + ak * r / (2 * ck * delta[i]), 0.0), 1.0);
+      const auto p = FromUnit(x);
+      std::cerr << "Step " << k + 1 << "/" << steps << ": score " << score << "/" << num_games
+                << ", bias " << p.bias << ", margin " << p.margin_weight << std::endl;
+    }
+    const double seconds = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start_time).count() / 1000.0;
+
+    const player::ParamTable::Entry entry{opt.game, opt.size, by_time, budget, FromUnit(x)};
+    std::cout << "Game = " << opt.game << " " << opt.size << "x" << opt.size << std::endl
+              << "Budget = " << opt.budget << std::endl
+              << "Games = " << steps * num_games << std::endl
+              << "Time = " << seconds << " sec" << std::endl
+              << "Bias = " << entry.params.bias << std::endl
+              << "Margin = " << entry.params.margin_weight << std::endl;
+    if (opt.table.empty()) return;
+    player::ParamTable table;
+    if (!table.Load(opt.table.c_str()) && std::ifstream(opt.table)) {
+      std::cerr << "Cannot parse " << opt.table << "; leaving it unchanged" << std::endl;
+      return;
+    }
+    table.Set(entry);
+    if (!table.Save(opt.table.c_str())) std::cerr << "Cannot write " << opt.table << std::endl;
+  }
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options opt;
+  for (int i = 1; i < argc; ++i) {
+    if (!ParseOption(opt, argv[i])) {
+      std::cerr << "usage: " << argv[0]
+                << " [--game=gomoku|othello[:SIZE]] [--budget=Nit|Nms] [--steps=N] [--pairs=N]"
+                << " [--threads=N] [--seed=N] [--bias=X] [--margin=W] [--table=FILE]" << std::endl;
+      return 1;
+    }
+  }
+  Tune tune{opt, false, 0};
+  if (!dispatch::Run(opt.game, opt.size, tune)) {
+    std::cerr << "Unsupported " << opt.game << " board size " << opt.size
+              << "; supported sizes are " << dispatch::GetSupportedSizes(opt.game) << std::endl;
+    return 1;
+  }
+  return 0;
+}
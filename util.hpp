@@ -1,9 +1,22 @@
 #pragma once
+#include <algorithm>
 #include <array>
 #include <cassert>
-#include <memory>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <new>
+#include <type_traits>
 #include <utility>
 #include <vector>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
 #define TERM_GRAY(s) "\e[38;5;242m" s "\e[0m"
 
@@ -14,29 +27,192 @@ inline T at_least_1(T x) {
   return x < 1 ? 1 : x;
 }
 
+// Spreads the pages of [p, p + bytes) over the NUMA nodes in nodes, a bit
+// per node id, round-robin as they are first touched. Returns false where
+// the kernel has no NUMA policy, which leaves the default placement on the
+// node of the thread that first touches each page.
+inline bool InterleavePages(void* p, const size_t bytes, uint64_t nodes) {
+#ifdef SYS_mbind
+  constexpr int MpolInterleave = 3;  // MPOL_INTERLEAVE, without needing numaif.h
+  return ::syscall(SYS_mbind, p, bytes, MpolInterleave, &nodes, 64, 0) == 0;
+#else
+  return false;
+#endif
+}
+
+// Hands out elements from chunks of N, and keeps the chunks when cleared,
+// so that a warm arena allocates nothing. The elements are
+// neither initialized nor destroyed: callers construct them in place.
 template<class T, size_t N>
-class FixedBulk {
+class Arena {
+  static_assert(std::is_trivially_destructible<T>::value, "T must be trivially destructible");
+
  public:
-  bool empty() const { return bulks_.empty() || bulks_[0].second[0] == 0; }
+  Arena() : chunk_(0), used_(0), high_water_(0), num_allocations_(0), interleave_(0), huge_pages_(false) {}
+
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  ~Arena() { Release(); }
+
+  // the most elements one Allocate may ask for
+  static constexpr size_t ChunkSize = N;
+
+  // Asks for transparent huge pages for the chunks allocated from now on.
+  void SetHugePages(const bool enabled) { huge_pages_ = enabled; }
+
+  // Interleaves the chunks allocated from now on over the given NUMA nodes,
+  // a bit per node id; 0 leaves each page on the node that first touches
+  // it, which is local to a thread that fills its own arena.
+  void SetInterleave(const uint64_t nodes) { interleave_ = nodes; }
+
+  bool empty() const { return size() == 0; }
+
+  // elements handed out since the last clear, including the ones skipped by
+  // Allocate(k) at the end of a chunk
+  size_t size() const { return chunk_ * N + used_; }
 
-  size_t size() const {
-    return bulks_.empty() ? 0 : (bulks_.size() - 1) * N + bulks_.back().second;
+  size_t capacity() const { return chunks_.size() * N; }
+
+  // the largest size() ever reached
+  size_t high_water() const { return std::max(high_water_, size()); }
+
+  // number of chunks allocated since construction
+  size_t num_allocations() const { return num_allocations_; }
+
+  // Forgets the elements and keeps the memory.
+  void clear() {
+    high_water_ = high_water();
+    chunk_ = 0;
+    used_ = 0;
   }
 
-  void clear() { bulks_.clear(); }
+  // Forgets the elements and frees the memory.
+  void Release() {
+    clear();
+    for (const auto& c : chunks_) ::munmap(c.first, c.second);
+    chunks_.clear();
+  }
 
-  T& Create() {
-    if (bulks_.empty() || bulks_.back().second == N) {
-      bulks_.emplace_back(std::unique_ptr<std::array<T, N>>{new std::array<T, N>{}}, 0);
+  // Returns storage for k contiguous elements, leaving the rest of the
+  // current chunk unused if they do not fit in it.
+  T* Allocate(const size_t k) {
+    assert(k <= N);
+    if (chunks_.empty()) {
+      AddChunk();
+    } else if (used_ + k > N) {
+      ++chunk_;
+      used_ = 0;
+      if (chunk_ == chunks_.size()) AddChunk();
     }
-    return (*bulks_.back().first)[bulks_.back().second++];
+    T* p = static_cast<T*>(chunks_[chunk_].first) + used_;
+    used_ += k;
+    return p;
   }
 
-  const T& operator[](const size_t i) const { return (*bulks_[i / N].first)[i % N]; }
-  T& operator[](const size_t i) { return (*bulks_[i / N].first)[i % N]; }
+ private:
+  static constexpr size_t HugePageSize = 2 << 20;
+
+  void AddChunk() {
+    size_t bytes = N * sizeof(T);
+    if (huge_pages_) bytes = (bytes + HugePageSize - 1) / HugePageSize * HugePageSize;
+    // anonymous pages are zeroed lazily by the kernel, not by a pass over the chunk
+    void* p = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) throw std::bad_alloc();
+    if (interleave_) InterleavePages(p, bytes, interleave_);
+#ifdef MADV_HUGEPAGE
+    if (huge_pages_) ::madvise(p, bytes, MADV_HUGEPAGE);
+#endif
+    chunks_.emplace_back(p, bytes);
+    ++num_allocations_;
+  }
+
+  std::vector<std::pair<void*, size_t>> chunks_;  // address and length of each mapping
+  size_t chunk_;  // the chunk being filled
+  size_t used_;   // elements used in it
+  size_t high_water_;
+  size_t num_allocations_;
+  uint64_t interleave_;
+  bool huge_pages_;
+};
+
+// Rounds n up to the number of floats processed at once by ArgMaxMulAdd.
+inline constexpr size_t PadToLanes(const size_t n) {
+  return (n + 3) & ~static_cast<size_t>(3);
+}
+
+// Returns the first index i < n maximizing a[i] + k * b[i]. Both arrays must
+// be readable up to PadToLanes(n), with a = -inf and b = 0 in the padding.
+inline size_t ArgMaxMulAdd(const float* a, const float* b, const float k, const size_t n) {
+#ifdef __SSE2__
+  const __m128 kk = _mm_set1_ps(k);
+  const __m128i four = _mm_set1_epi32(4);
+  __m128 best = _mm_set1_ps(-std::numeric_limits<float>::infinity());
+  __m128i best_index = _mm_setzero_si128();
+  __m128i index = _mm_setr_epi32(0, 1, 2, 3);
+  for (size_t i = 0; i < n; i += 4) {
+    const __m128 v = _mm_add_ps(_mm_loadu_ps(a + i), _mm_mul_ps(kk, _mm_loadu_ps(b + i)));
+    const __m128 gt = _mm_cmpgt_ps(v, best);
+    best = _mm_or_ps(_mm_and_ps(gt, v), _mm_andnot_ps(gt, best));
+    const __m128i gti = _mm_castps_si128(gt);
+    best_index = _mm_or_si128(_mm_and_si128(gti, index), _mm_andnot_si128(gti, best_index));
+    index = _mm_add_epi32(index, four);
+  }
+  alignas(16) float values[4];
+  alignas(16) int32_t indices[4];
+  _mm_store_ps(values, best);
+  _mm_store_si128(reinterpret_cast<__m128i*>(indices), best_index);
+  int j = 0;
+  for (int l = 1; l < 4; ++l) {
+    if (values[l] > values[j] || (values[l] == values[j] && indices[l] < indices[j])) j = l;
+  }
+  return indices[j];
+#else
+  size_t j = 0;
+  float best = a[0] + k * b[0];
+  for (size_t i = 1; i < n; ++i) {
+    const float v = a[i] + k * b[i];
+    if (v > best) {
+      best = v;
+      j = i;
+    }
+  }
+  return j;
+#endif
+}
+
+// A read-only memory mapping of a whole file.
+class MappedFile {
+ public:
+  explicit MappedFile(const char* path) : data_(nullptr), size_(0) {
+    const int fd = ::open(path, O_RDONLY);
+    if (fd < 0) return;
+    struct stat st;
+    if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+      void* p = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (p != MAP_FAILED) {
+        data_ = static_cast<const uint8_t*>(p);
+        size_ = st.st_size;
+        ::madvise(p, size_, MADV_SEQUENTIAL);
+      }
+    }
+    ::close(fd);
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  ~MappedFile() {
+    if (data_) ::munmap(const_cast<uint8_t*>(data_), size_);
+  }
+
+  bool ok() const { return data_ != nullptr; }
+  const uint8_t* data() const { return data_; }
+  size_t size() const { return size_; }
 
  private:
-  std::vector<std::pair<std::unique_ptr<std::array<T, N>>, size_t>> bulks_;
+  const uint8_t* data_;
+  size_t size_;
 };
 
 template<int B, size_t N>
@@ -49,7 +225,10 @@ class BitPack {
  public:
   BitPack() : bits_() {}
 
-  void clear() { bits_.clear(); }
+  void clear() { bits_.fill(0); }
+
+  // the packed elements, first element in the most significant bits
+  const std::array<uint8_t, (B * N + 7) / 8>& bytes() const { return bits_; }
 
   class ElementProxy {
    public:
@@ -0,0 +1,135 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "numa.hpp"
+
+namespace util {
+
+// A fixed set of threads running submitted tasks in FIFO order. Each task is
+// given the index of the worker running it, so that it can use per-worker
+// state such as warm engines without locking.
+//
+// Given a topology, each worker is pinned to a cpu of a NUMA node (see
+// Topology::GetCpu), so that the memory it first touches, such as the search
+// trees of its engines, stays local to it.
+class WorkerPool {
+ public:
+  using Task = std::function<void(size_t worker)>;
+
+  // Without a topology the workers are not pinned.
+  explicit WorkerPool(const size_t num_workers, const Topology* topology = nullptr)
+      : stop_(false), num_busy_(0) {
+    for (size_t i = 0; i < num_workers; ++i) {
+      const int cpu = topology ? topology->GetCpu(i) : -1;
+      threads_.emplace_back([this, i, cpu] {
+        if (cpu >= 0) PinThread(cpu);
+        Run(i);
+      });
+    }
+  }
+
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  // Finishes the queued tasks before returning.
+  ~WorkerPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    task_cv_.notify_all();
+    for (auto& t : threads_) t.join();
+  }
+
+  size_t size() const { return threads_.size(); }
+
+  void Submit(Task task) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      tasks_.push_back(std::move(task));
+    }
+    task_cv_.notify_one();
+  }
+
+  // Blocks until every submitted task has finished.
+  void Wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_cv_.wait(lock, [this] { return tasks_.empty() && num_busy_ == 0; });
+  }
+
+ private:
+  void Run(const size_t worker) {
+    for (;;) {
+      Task task;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        task_cv_.wait(lock, [this] { return !tasks_.empty() || stop_; });
+        if (tasks_.empty()) return;  // stopping
+        task = std::move(tasks_.front());
+        tasks_.pop_front();
+        ++num_busy_;
+      }
+      task(worker);
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        --num_busy_;
+      }
+      idle_cv_.notify_all();
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable task_cv_;
+  std::condition_variable idle_cv_;
+  std::deque<Task> tasks_;
+  std::vector<std::thread> threads_;
+  bool stop_;
+  size_t num_busy_;
+};
+
+// Runs f(worker, task) for every task in [0, num_tasks) on num_workers
+// threads and returns once all are done. The tasks are dealt round-robin to
+// per-worker deques; a worker takes from the back of its own and, once that
+// is empty, steals from the front of the others', so that tasks of very
+// uneven cost still keep every thread busy.
+inline void RunWorkStealing(const size_t num_workers, const size_t num_tasks,
+                            const std::function<void(size_t worker, size_t task)>& f) {
+  struct Queue {
+    std::mutex mutex;
+    std::deque<size_t> tasks;
+  };
+  std::vector<Queue> queues(num_workers);
+  for (size_t i = 0; i < num_tasks; ++i) queues[i % num_workers].tasks.push_back(i);
+
+  auto take = [&queues, num_workers] (const size_t worker, size_t& task) {
+    for (size_t k = 0; k < num_workers; ++k) {
+      Queue& q = queues[(worker + k) % num_workers];
+      std::lock_guard<std::mutex> lock(q.mutex);
+      if (q.tasks.empty()) continue;
+      if (k == 0) {
+        task = q.tasks.back();
+        q.tasks.pop_back();
+      } else {
+        task = q.tasks.front();
+        q.tasks.pop_front();
+      }
+      return true;
+    }
+    return false;  // no task is left, since tasks never add more
+  };
+
+  std::vector<std::thread> threads;
+  for (size_t w = 0; w < num_workers; ++w) {
+    threads.emplace_back([&take, &f, w] {
+      size_t task;
+      while (take(w, task)) f(w, task);
+    });
+  }
+  for (auto& t : threads) t.join();
+}
+
+}  // namespace util